@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "ku_mmu.h"
+
+/*
+    ku_mmu_init 이후의 MMU 경로가 malloc 을 부르지 않는지, superpage 가 데이터를 잃지 않는지 확인하는 드라이버
+
+    사용법: ku_alloc_check [ops]
+        - radix/hashed page table, superpage 를 켠 경우와 끈 경우마다 ku_mmu_init 을 한 뒤
+        - 여러 process 사이의 ku_run_proc, ku_reference, ku_page_fault (swap out/in, OOM 포함) 와 ku_mmu_reset 을 돌리고
+        - 그 사이에 malloc/calloc/realloc 이 한 번이라도 불렸으면 실패로 끝난다. (exit 1)
+        - superpage: 순서대로 채운 페이지들이 superpage 로 올라가고 (promote), 다른 process 때문에 swap out 되면서
+          PageTable 로 되돌아간 (demote) 뒤 다시 swap in 해도 페이지에 써 둔 값이 그대로인지 확인한다.
+    malloc 호출 수는 ku_bench 처럼 glibc 의 malloc 을 가로채서 센다. (sanitizer 빌드에서는 malloc 수만 확인하지 않는다)
+*/
+
+unsigned long nr_malloc;
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+#define ALLOC_COUNTED 1
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* p, size_t size);
+void* malloc(size_t size) { nr_malloc++; return __libc_malloc(size); }
+void* calloc(size_t n, size_t size) { nr_malloc++; return __libc_calloc(n, size); }
+void* realloc(void* p, size_t size) { nr_malloc++; return __libc_realloc(p, size); }
+#else
+#define ALLOC_COUNTED 0
+#endif
+
+unsigned long runOps(int ops) {
+    /*
+        pid 1 ~ 4 가 번갈아 가며 의사 난수 주소를 접근한다. 중간에 한 번 ku_mmu_reset 을 한다.
+        그동안 불린 malloc 수를 반환한다.
+    */
+    void* ku_cr3;
+    unsigned int s = 7;
+    unsigned long before = nr_malloc;
+    for (int i = 0; i < ops; ++i) {
+        s = s * 1103515245 + 12345;
+        char pid = 1 + (s >> 16) % 4;
+        unsigned char va = (s >> 8) & 0xfc;
+        if (ku_run_proc(pid, &ku_cr3) < 0) continue;
+        if (ku_reference(pid, va) < 0) ku_page_fault(pid, va);
+        if (i == ops / 2) ku_mmu_reset();
+    }
+    return nr_malloc - before;
+}
+
+int countLost(int swapin) {
+    /*
+        pid 1 의 앞쪽 페이지들 중 checkSuperpage 가 써 둔 값과 다른 페이지 수.
+        swapin 이 FALSE 면 지금 매핑되어 있는 페이지만 보고, TRUE 면 swap out 된 페이지도 다시 fault 해서 본다.
+    */
+    int lost = 0, pfn;
+    for (int va = 0; va < 128; va += 4) {
+        pfn = walkPage(searchPCB(1), va);
+        if (!pfn && swapin) {
+            ku_page_fault(1, va);
+            pfn = walkPage(searchPCB(1), va);
+            if (!pfn) lost++;
+        }
+        if (pfn && ((char*)getPage(pfn))[1] != (char)(va ^ 0x5a)) lost++;
+    }
+    return lost;
+}
+
+int checkSuperpage() {
+    /*
+        superpage 를 켜고 pid 1 의 앞쪽 페이지들을 순서대로 fault 하면서 각 페이지에 값을 써 두고,
+        pid 2 의 페이지로 물리 메모리를 채워서 pid 1 의 superpage 를 swap out (demote) 시킨다.
+        pid 2 의 fault 마다 pid 1 의 매핑된 페이지를 확인하고, 마지막에 모든 페이지를 다시 swap in 해서 확인한다.
+        promote, demote 가 한 번도 일어나지 않았거나 값이 바뀐 페이지가 있으면 1, 아니면 0 반환.
+    */
+    void* ku_cr3;
+    unsigned long promote, demote;
+    int lost = 0, pfn;
+
+    ku_set_pt_mode(PT_RADIX);
+    ku_set_superpage(1);
+    if (!ku_mmu_init(256, 512)) {
+        printf("ku_alloc_check: ku_mmu_init failed\n");
+        exit(1);
+    }
+    ku_run_proc(1, &ku_cr3);
+    for (int va = 0; va < 128; va += 4) {
+        ku_page_fault(1, va);
+        pfn = walkPage(searchPCB(1), va);
+        if (pfn) ((char*)getPage(pfn))[1] = va ^ 0x5a;
+    }
+    promote = nr_promote;
+    ku_run_proc(2, &ku_cr3);
+    for (int va = 0; va < 256; va += 4) {
+        ku_page_fault(2, va);
+        lost += countLost(FALSE);
+    }
+    demote = nr_demote;
+    ku_run_proc(1, &ku_cr3);
+    lost += countLost(TRUE);
+    printf("superpage 256/512: promote %lu, demote %lu, swap out %lu, lost %d\n", promote, demote, nr_swapout, lost);
+    ku_mmu_destroy();
+    ku_set_superpage(0);
+    return promote == 0 || demote == 0 || lost > 0;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int cfg[][2] = { { 64, 32 }, { 128, 64 }, { 256, 512 } };
+    int ops = argc > 1 ? atoi(argv[1]) : 20000;
+    int fail = 0;
+
+    if (ops < 1) {
+        printf("ku_alloc_check: Invalid ops\n");
+        exit(1);
+    }
+    if (checkSuperpage()) fail = 1;
+    if (!ALLOC_COUNTED) {
+        printf("ku_alloc_check: malloc is not counted in this build, skipped\n");
+        printf("%s\n", fail ? "FAIL" : "OK");
+        return fail;
+    }
+    for (int mode = PT_RADIX; mode <= PT_HASHED; ++mode) {
+        for (int sp = 0; sp <= 1; ++sp) {
+            for (int i = 0; i < 3; ++i) {
+                unsigned long n;
+                ku_set_pt_mode(mode);
+                ku_set_superpage(sp);
+                if (!ku_mmu_init(cfg[i][0], cfg[i][1])) {
+                    printf("ku_alloc_check: ku_mmu_init failed\n");
+                    exit(1);
+                }
+                n = runOps(ops);
+                ku_mmu_destroy();
+                printf("%-6s %-9s %u/%u: %lu malloc\n", mode == PT_HASHED ? "hashed" : "radix",
+                    sp ? "superpage" : "", cfg[i][0], cfg[i][1], n);
+                if (n) fail = 1;
+            }
+        }
+    }
+    printf("%s\n", fail ? "FAIL" : "OK");
+    return fail;
+}
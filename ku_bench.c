@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ku_mmu.h"
+
+/*
+    MMU 의 주요 경로별 벤치마크
+
+    사용법: ku_bench [reps]
+        - init: ku_mmu_init (+ ku_mmu_destroy 는 teardown 으로 따로 잰다)
+        - first-touch: free page 가 남아있을 때 처음 접근하는 페이지의 ku_page_fault
+        - re-fault: 이미 매핑된 페이지의 ku_page_fault
+        - reference: 이미 매핑된 페이지의 ku_reference
+        - swap-cycle: PageFrame 이 하나뿐일 때 두 페이지를 번갈아 접근 (swap out + swap in)
+        - run-proc: 두 process 사이의 ku_run_proc context switch
+        - reset, teardown: ku_mmu_reset, ku_mmu_destroy
+        - first-touch/re-fault/reference/reset 은 hashed inverted page table (PT_HASHED) 로도 잰다. (pmem/swap 뒤에 hashed)
+        - scan, count: 메타데이터를 훑는 커널 (scalar/SSE2/AVX2) 별로 큰 바이트 배열 전체를 훑는 시간
+          (PTE 의 pfn 이 6 bit 라서 MMU 의 메타데이터는 작으므로, MMU 없이 배열만 만들어서 잰다. pmem/swap 자리에 배열 크기)
+    결과는 op 하나당 ns 의 평균, 백분위수와 op 하나당 malloc 호출 수로 출력한다.
+*/
+
+#define BENCH_MAX_SAMPLES 1000000
+
+/*
+    malloc 호출 수 (glibc 에서는 malloc/calloc/realloc 을 가로채서 센다. sanitizer 빌드에서는 세지 않는다)
+*/
+unsigned long nr_malloc;
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* p, size_t size);
+void* malloc(size_t size) { nr_malloc++; return __libc_malloc(size); }
+void* calloc(size_t n, size_t size) { nr_malloc++; return __libc_calloc(n, size); }
+void* realloc(void* p, size_t size) { nr_malloc++; return __libc_realloc(p, size); }
+#endif
+
+/*
+    벤치마크 하나의 측정값
+*/
+typedef struct bench_ {
+    const char* name;
+    unsigned int pmem_size, swap_size;
+    const char* cfg;  // NULL 이 아니면 pmem/swap 대신 출력할 설정
+    long long* ns;  // op 별 걸린 시간
+    int n;
+    unsigned long mallocs;
+} Bench;
+
+long long* samples;
+
+int cmpLL(const void* a, const void* b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+void beginBench(Bench* b, const char* name, unsigned int pmem_size, unsigned int swap_size) {
+    b->name = name;
+    b->pmem_size = pmem_size;
+    b->swap_size = swap_size;
+    b->cfg = NULL;
+    b->ns = samples;
+    b->n = 0;
+    b->mallocs = nr_malloc;
+}
+
+void addSample(Bench* b, long long ns) {
+    if (b->n < BENCH_MAX_SAMPLES) b->ns[b->n++] = ns;
+}
+
+void endBench(Bench* b) {
+    /*
+        평균과 p50/p90/p99/max 를 한 줄로 출력한다.
+    */
+    long long sum = 0;
+    char cfg[32];
+    double mallocs = b->n ? (double)(nr_malloc - b->mallocs) / b->n : 0;
+    if (b->cfg) snprintf(cfg, sizeof(cfg), "%s", b->cfg);
+    else snprintf(cfg, sizeof(cfg), "%u/%u%s", b->pmem_size, b->swap_size, pt_mode == PT_HASHED ? " hashed" : "");
+    if (b->n == 0) {
+        printf("%-12s %-18s %8s\n", b->name, cfg, "-");
+        return;
+    }
+    qsort(b->ns, b->n, sizeof(long long), cmpLL);
+    for (int i = 0; i < b->n; ++i) sum += b->ns[i];
+    printf("%-12s %-18s %8d %10.1f %8lld %8lld %8lld %10lld %10.3f\n",
+        b->name, cfg, b->n, (double)sum / b->n,
+        b->ns[b->n / 2], b->ns[b->n * 9 / 10], b->ns[b->n * 99 / 100], b->ns[b->n - 1], mallocs);
+}
+
+void benchInit(unsigned int pmem_size, unsigned int swap_size, int reps) {
+    /*
+        teardown 은 PageFrame 을 채운 뒤에 잰다. PTE 의 pfn 은 6 bit 이므로, 물리 메모리가 더 커도
+        fault 한 번에 새로 쓰는 page (PageMidDir, PageTable, PageFrame 최대 3 개) 가 pfn PFN_LIMIT 아래에 들어갈 때까지만 채운다.
+    */
+    Bench init, teardown;
+    beginBench(&init, "init", pmem_size, swap_size);
+    for (int r = 0; r < reps; ++r) {
+        long long t = getNs();
+        ku_mmu_init(pmem_size, swap_size);
+        addSample(&init, getNs() - t);
+        ku_mmu_destroy();
+    }
+    endBench(&init);
+    beginBench(&teardown, "teardown", pmem_size, swap_size);
+    for (int r = 0; r < reps; ++r) {
+        void* ku_cr3;
+        ku_mmu_init(pmem_size, swap_size);
+        ku_run_proc(1, &ku_cr3);
+        for (int va = 0; va < 256 && nr_free > 0 && pf_hwm + 3 <= PFN_LIMIT; va += 4) ku_page_fault(1, va);
+        long long t = getNs();
+        ku_mmu_destroy();
+        addSample(&teardown, getNs() - t);
+    }
+    endBench(&teardown);
+}
+
+void benchFaults(unsigned int pmem_size, unsigned int swap_size, int reps) {
+    /*
+        reset 후 free page 가 남아있는 동안 새 페이지를 접근해서 first-touch 를 재고,
+        그렇게 매핑된 페이지들로 re-fault 와 reference 를 잰다.
+    */
+    Bench first, refault, ref, reset;
+    void* ku_cr3;
+    unsigned char mapped[64];
+    int nmapped;
+
+    ku_mmu_init(pmem_size, swap_size);
+    beginBench(&first, "first-touch", pmem_size, swap_size);
+    for (int r = 0; r < reps; ++r) {
+        ku_mmu_reset();
+        ku_run_proc(1, &ku_cr3);
+        for (int va = 0; va < 256 && nr_free > 0; va += 4) {
+            long long t = getNs();
+            ku_page_fault(1, va);
+            addSample(&first, getNs() - t);
+        }
+    }
+    endBench(&first);
+
+    // 지금 매핑되어 있는 페이지들
+    nmapped = 0;
+    for (int va = 0; va < 256; va += 4)
+        if (ku_reference(1, va) == 0) mapped[nmapped++] = va;
+    beginBench(&refault, "re-fault", pmem_size, swap_size);
+    for (int r = 0; r < reps; ++r) {
+        for (int i = 0; i < nmapped; ++i) {
+            long long t = getNs();
+            ku_page_fault(1, mapped[i]);
+            addSample(&refault, getNs() - t);
+        }
+    }
+    endBench(&refault);
+    beginBench(&ref, "reference", pmem_size, swap_size);
+    for (int r = 0; r < reps; ++r) {
+        for (int i = 0; i < nmapped; ++i) {
+            long long t = getNs();
+            ku_reference(1, mapped[i]);
+            addSample(&ref, getNs() - t);
+        }
+    }
+    endBench(&ref);
+
+    beginBench(&reset, "reset", pmem_size, swap_size);
+    for (int r = 0; r < reps; ++r) {
+        ku_run_proc(1, &ku_cr3);
+        for (int va = 0; va < 256 && nr_free > 0; va += 4) ku_page_fault(1, va);
+        long long t = getNs();
+        ku_mmu_reset();
+        addSample(&reset, getNs() - t);
+    }
+    endBench(&reset);
+    ku_mmu_destroy();
+}
+
+void benchSwap(unsigned int swap_size, int reps) {
+    /*
+        PageDir/PageMidDir/PageTable 3 개와 PageFrame 1 개만 들어가는 물리 메모리에서
+        같은 PageTable 의 두 페이지를 번갈아 접근하면, 매 fault 마다 swap out 과 swap in 이 한 번씩 일어난다.
+    */
+    Bench cyc;
+    void* ku_cr3;
+    unsigned int pmem_size = 4 * 5;
+    ku_mmu_init(pmem_size, swap_size);
+    ku_run_proc(1, &ku_cr3);
+    ku_page_fault(1, 0);
+    ku_page_fault(1, 4);
+    beginBench(&cyc, "swap-cycle", pmem_size, swap_size);
+    for (int r = 0; r < reps; ++r) {
+        for (int va = 0; va <= 4; va += 4) {
+            long long t = getNs();
+            ku_page_fault(1, va);
+            addSample(&cyc, getNs() - t);
+        }
+    }
+    endBench(&cyc);
+    ku_mmu_destroy();
+}
+
+void benchRunProc(unsigned int pmem_size, unsigned int swap_size, int reps) {
+    Bench sw;
+    void* ku_cr3;
+    ku_mmu_init(pmem_size, swap_size);
+    ku_run_proc(1, &ku_cr3);
+    ku_run_proc(2, &ku_cr3);
+    beginBench(&sw, "run-proc", pmem_size, swap_size);
+    for (int r = 0; r < reps; ++r) {
+        for (int pid = 1; pid <= 2; ++pid) {
+            long long t = getNs();
+            ku_run_proc(pid, &ku_cr3);
+            addSample(&sw, getNs() - t);
+        }
+    }
+    endBench(&sw);
+    ku_mmu_destroy();
+}
+
+void benchScan(int n, int reps) {
+    /*
+        n 바이트 배열에서 마지막 바이트만 다른 값일 때, 커널 종류마다 findByte 로 그 바이트를 찾는 시간과
+        count_byte 로 배열 전체를 세는 시간을 잰다. CPU 가 지원하지 않는 커널은 건너뛴다.
+    */
+    const char* impl_name[] = { "scalar", "sse2", "avx2" };
+    char* a = (char*)calloc(n, 1);
+    char name[2][16], cfg[32];
+    volatile int sink = 0;
+    a[n - 1] = 1;
+    for (int level = SCAN_SCALAR; level <= SCAN_AVX2; ++level) {
+        Bench scan, count;
+        if (ku_set_scan_impl(level) != level) continue;
+        snprintf(name[0], sizeof(name[0]), "scan-%s", impl_name[level]);
+        snprintf(name[1], sizeof(name[1]), "count-%s", impl_name[level]);
+        snprintf(cfg, sizeof(cfg), "%d bytes", n);
+        beginBench(&scan, name[0], 0, 0);
+        scan.cfg = cfg;
+        for (int r = 0; r < reps; ++r) {
+            long long t = getNs();
+            sink += findByte(a, 0, n, 1);
+            addSample(&scan, getNs() - t);
+        }
+        endBench(&scan);
+        beginBench(&count, name[1], 0, 0);
+        count.cfg = cfg;
+        for (int r = 0; r < reps; ++r) {
+            long long t = getNs();
+            sink += count_byte(a, n, 0);
+            addSample(&count, getNs() - t);
+        }
+        endBench(&count);
+    }
+    ku_set_scan_impl(SCAN_AVX2);
+    free(a);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int cfg[][2] = { { 64, 128 }, { 128, 256 }, { 256, 512 } };  // PTE 의 pfn 이 6 bit 이므로 물리 메모리는 최대 256 바이트
+    unsigned int init_cfg[][2] = { { 256, 512 }, { 1 << 20, 1 << 20 }, { 1 << 26, 1 << 26 } };
+    int reps = argc > 1 ? atoi(argv[1]) : 2000;
+
+    if (reps < 1) {
+        printf("ku_bench: Invalid reps\n");
+        exit(1);
+    }
+    samples = (long long*)malloc(sizeof(long long) * BENCH_MAX_SAMPLES);
+    printf("%-12s %-18s %8s %10s %8s %8s %8s %10s %10s\n", "bench", "pmem/swap", "ops", "mean(ns)", "p50", "p90", "p99", "max", "malloc/op");
+    for (int i = 0; i < 3; ++i) benchInit(init_cfg[i][0], init_cfg[i][1], reps);
+    for (int i = 0; i < 3; ++i) benchFaults(cfg[i][0], cfg[i][1], reps);
+    ku_set_pt_mode(PT_HASHED);
+    for (int i = 0; i < 3; ++i) benchFaults(cfg[i][0], cfg[i][1], reps);
+    ku_set_pt_mode(PT_RADIX);
+    for (int i = 0; i < 3; ++i) benchSwap(cfg[i][1], reps);
+    for (int i = 0; i < 3; ++i) benchRunProc(cfg[i][0], cfg[i][1], reps);
+    benchScan(1 << 20, reps);
+    free(samples);
+    return 0;
+}
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "ku_mmu.h"
+
+/*
+    KU_MMU_TRACE 로 빌드한 MMU 가 남긴 event trace 를 읽어서 사람이 볼 수 있게 출력하는 도구
+
+    사용법: ku_evdump [-l] <event 파일>
+        - event 를 seq 순서로 다시 적용해서 MMU 상태를 똑같이 만들고,
+          ku_mmu_init, ku_page_fault, ku_run_proc 이 끝날 때마다 pt_* 함수로 표를 출력한다. (예전 ku_mmu_print.h 와 같은 화면)
+        - -l 을 주면 표 대신 event 를 한 줄씩 출력한다.
+        - PageFrame 의 내용은 MMU 가 옮길 때 (swap in/out) 만 기록되므로, 그 사이에 process 가 쓴 값은 보이지 않는다.
+*/
+
+const char* ev_name[EV_NR] = {
+    "?", "init", "reset", "fault-begin", "fault-end", "run-proc", "proc-new", "proc-exit",
+    "page-alloc", "page-free", "page-data", "pte", "pgf-add", "pgf-del", "swap-set", "swap-use", "swap-free",
+    "reclaim-begin", "reclaim-end", "pgf-set"
+};
+
+int cmpSeq(const void* a, const void* b) {
+    unsigned long long x = ((const Event_Rec*)a)->seq, y = ((const Event_Rec*)b)->seq;
+    return (x > y) - (x < y);
+}
+
+Event_Rec* readEvents(const char* path, size_t* n) {
+    /*
+        event 파일을 읽어서 seq 순서로 정렬한 배열을 반환한다. (형식이 맞지 않으면 NULL 반환)
+    */
+    Event_Header h;
+    Event_Rec* ev;
+    struct stat st;
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) return NULL;
+    if (fstat(fileno(fp), &st) || fread(&h, sizeof(h), 1, fp) != 1
+        || memcmp(h.magic, EVENT_MAGIC, 8) || h.version != EVENT_VERSION || h.rec_size != sizeof(Event_Rec)) {
+        fclose(fp);
+        return NULL;
+    }
+    *n = ((size_t)st.st_size - sizeof(h)) / sizeof(Event_Rec);
+    ev = (Event_Rec*)malloc(sizeof(Event_Rec) * (*n ? *n : 1));
+    if (ev) *n = fread(ev, sizeof(Event_Rec), *n, fp);
+    fclose(fp);
+    if (ev) qsort(ev, *n, sizeof(Event_Rec), cmpSeq);
+    return ev;
+}
+
+void printTables() {
+    pt_pg_free_list();
+    pt_sp_list();
+    pt_pgf_queue();
+}
+
+void printReturn(int fail) {
+    printf(fail ? "\n:return: -1 (fail)\n" : "\n:return: 0 (success)\n");
+}
+
+void applyEvent(const Event_Rec* ev, int views) {
+    /*
+        event 하나를 지금 MMU 상태에 적용한다. views 가 TRUE 면 API 호출이 끝나는 event 에서 표를 출력한다.
+    */
+    PCB* pcb = searchPCB(ev->pid);
+    int pfn_ok = ev->a > 0 && ev->a < pfl_sz, spn_ok = ev->a > 0 && ev->a < spl_sz;
+
+    switch (ev->type) {
+    case EV_INIT:
+        ku_mmu_init(ev->a * 4, ev->b * 4);
+        if (!views) break;
+        printf("\n========================\n");
+        printf("<ku_mmu_init test print>\n");
+        printf("  pmem: %p\n", (void*)pmem_base);
+        printf("  smem: %p\n", (void*)smem_base);
+        printf("  npage: %d\n", pfl_sz);
+        printf("  nswap: %d\n", spl_sz);
+        printf("\n");
+        printTables();
+        break;
+    case EV_RESET:
+        ku_mmu_reset();
+        if (views) printf("\n========================\n<ku_mmu_reset>\n");
+        break;
+    case EV_FAULT_BEGIN:
+        if (!views) break;
+        printf("\n===============================\n");
+        printf("<ku_page_fault(pid: %d, va: %d)>\n", ev->pid, ev->x);
+        break;
+    case EV_FAULT_END:
+        if (!views) break;
+        printf("\n[ AFTER ]:\n");
+        printTables();
+        printReturn(ev->y == FAULT_FAIL);
+        break;
+    case EV_RUN_PROC:
+        if (pcb && ev->a > 0 && ev->a < pfl_sz) pcb->pgdir = getPage(ev->a);
+        if (!views) break;
+        printf("\n=============================================\n");
+        printf("<ku_run_proc(pid: %d) test print>\n", ev->pid);
+        printf("\npcb_list after: \n");
+        pt_pcb_list();
+        printTables();
+        printReturn(ev->y);
+        break;
+    case EV_PROC_NEW:
+        if (pcb == NULL) pcb = addPCB(pcb_list, ev->pid);
+        if (ev->a > 0 && ev->a < pfl_sz) pcb->pgdir = getPage(ev->a);
+        break;
+    case EV_PROC_EXIT:
+        if (pcb) removePCB(pcb_list, pcb);
+        break;
+    case EV_PAGE_ALLOC:
+        if (!pfn_ok) break;
+        pf_type[ev->a] = ev->y;
+        pf_used[ev->a] = TRUE;
+        pf_pid[ev->a] = ev->pid;
+        setZeroPage(getPage(ev->a));
+        break;
+    case EV_PAGE_FREE:
+        if (!pfn_ok) break;
+        pf_type[ev->a] = P_TYPE_UNDEFINED;
+        pf_used[ev->a] = FALSE;
+        setZeroPage(getPage(ev->a));
+        break;
+    case EV_PAGE_DATA:
+        if (pfn_ok) memcpy(getPage(ev->a)->pte, ev->data, 4);
+        break;
+    case EV_PTE:
+        if (pfn_ok && ev->x < 4) getPage(ev->a)->pte[ev->x] = ev->y;
+        break;
+    case EV_PGF_ADD:
+        if (pfn_ok) addPGF(ev->a, ev->b, ev->x, ev->y);
+        break;
+    case EV_PGF_DEL:
+        if (pfn_ok) removePGF(ev->a);
+        break;
+    case EV_PGF_SET:
+        if (pfn_ok) setPGF(ev->a, ev->b, ev->x);
+        break;
+    case EV_SWAP_SET:
+        if (!spn_ok) break;
+        memcpy(getSwapSpace(ev->a)->pte, ev->data, 4);
+        sp_pgtable[ev->a] = ev->b;
+        sp_ptenti[ev->a] = ev->x;
+        sp_pid[ev->a] = ev->pid;
+        sp_fadd[ev->a] = ev->y;
+        sp_used[ev->a] = TRUE;
+        break;
+    case EV_SWAP_USE:
+        if (spn_ok) sp_used[ev->a] = ev->y;
+        break;
+    case EV_SWAP_FREE:
+        if (!spn_ok) break;
+        sp_used[ev->a] = FALSE;
+        sp_pgtable[ev->a] = 0;
+        break;
+    }
+}
+
+void printEvent(const Event_Rec* ev, unsigned long long t0) {
+    printf("%12.3f us  #%-8llu %-11s pid %3d  x %3d  y %3d  a %4d  b %4d  data %02x %02x %02x %02x\n",
+        (ev->ts - t0) / 1e3, ev->seq, ev->type < EV_NR ? ev_name[ev->type] : "?", ev->pid, ev->x, ev->y, ev->a, ev->b,
+        (unsigned char)ev->data[0], (unsigned char)ev->data[1], (unsigned char)ev->data[2], (unsigned char)ev->data[3]);
+}
+
+int main(int argc, char* argv[]) {
+    int list = FALSE;
+    size_t n;
+    Event_Rec* ev;
+
+    if (argc > 1 && strcmp(argv[1], "-l") == 0) {
+        list = TRUE;
+        argc--;
+        argv++;
+    }
+    if (argc != 2) {
+        printf("ku_evdump: Wrong number of arguments\n");
+        printf("usage: ku_evdump [-l] <events>\n");
+        exit(1);
+    }
+    if ((ev = readEvents(argv[1], &n)) == NULL) {
+        printf("ku_evdump: Cannot read %s\n", argv[1]);
+        exit(1);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (list) printEvent(ev + i, ev[0].ts);
+        else applyEvent(ev + i, TRUE);
+    }
+    ku_mmu_destroy();
+    free(ev);
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ku_workload.h"
+
+/*
+    ku_workload.h 로 접근 패턴을 만들어 trace 파일로 저장하는 도구
+
+    사용법: ku_gen [-s seed] [-p nproc] [-c switch_every] [-w write_ratio] <out> <phase>...
+        phase: pattern:length:base:npages[:param]
+            - pattern: seq, stride, zipf, uniform
+            - param: stride 면 보폭 (페이지 단위), zipf 면 지수
+        예) ku_gen -s 7 -p 4 -c 200 out.trace seq:100000:0:48 zipf:500000:0:64:1.1 stride:100000:8:32:3
+    빌드: zipf 분포에 pow 를 쓰므로 math library 를 링크해야 한다. 예) cc -O2 -o ku_gen ku_gen.c -lm
+*/
+
+int parsePattern(const char* name) {
+    if (strcmp(name, "seq") == 0) return WL_SEQ;
+    if (strcmp(name, "stride") == 0) return WL_STRIDE;
+    if (strcmp(name, "zipf") == 0) return WL_ZIPF;
+    if (strcmp(name, "uniform") == 0) return WL_UNIFORM;
+    return -1;
+}
+
+void usage() {
+    printf("usage: ku_gen [-s seed] [-p nproc] [-c switch_every] [-w write_ratio] <out> <phase>...\n");
+    printf("       phase = pattern:length:base:npages[:param]  (pattern: seq, stride, zipf, uniform)\n");
+    exit(1);
+}
+
+int main(int argc, char* argv[]) {
+    Workload wl;
+    unsigned long long seed = 1;
+    int nproc = 1, switch_every = 0, argi = 1;
+    double write_ratio = 0.3;
+    const char* out;
+    Trace_Rec* rec;
+    unsigned long long n;
+
+    // 옵션
+    while (argi + 1 < argc && argv[argi][0] == '-') {
+        if (strcmp(argv[argi], "-s") == 0) seed = strtoull(argv[argi + 1], NULL, 0);
+        else if (strcmp(argv[argi], "-p") == 0) nproc = atoi(argv[argi + 1]);
+        else if (strcmp(argv[argi], "-c") == 0) switch_every = atoi(argv[argi + 1]);
+        else if (strcmp(argv[argi], "-w") == 0) write_ratio = atof(argv[argi + 1]);
+        else usage();
+        argi += 2;
+    }
+    if (argc - argi < 2) {
+        printf("ku_gen: Wrong number of arguments\n");
+        usage();
+    }
+    out = argv[argi++];
+
+    // phase
+    ku_workload_init(&wl, seed, nproc, switch_every);
+    for (; argi < argc; ++argi) {
+        char name[16];
+        unsigned long long length;
+        int base, npages, pattern;
+        double param = 0;
+        if (sscanf(argv[argi], "%15[a-z]:%llu:%d:%d:%lf", name, &length, &base, &npages, &param) < 4
+            || (pattern = parsePattern(name)) < 0
+            || ku_workload_add_phase(&wl, pattern, length, base, npages, param, write_ratio)) {
+            printf("ku_gen: Invalid phase %s\n", argv[argi]);
+            usage();
+        }
+    }
+
+    // 생성 후 저장
+    n = ku_workload_length(&wl);
+    rec = (Trace_Rec*)malloc(sizeof(Trace_Rec) * (n ? n : 1));
+    if (rec == NULL) {
+        printf("ku_gen: Out of memory\n");
+        exit(1);
+    }
+    n = ku_workload_generate(&wl, rec, n);
+    if (ku_trace_write(out, rec, n)) {
+        printf("ku_gen: Cannot write %s\n", out);
+        exit(1);
+    }
+    printf("ku_gen: %llu records -> %s\n", n, out);
+    free(rec);
+    return 0;
+}
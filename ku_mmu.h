@@ -1,6 +1,22 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <stdarg.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KU_SCAN_X86
+#endif
 
 #define TRUE 1
 #define FALSE 0
@@ -17,10 +33,12 @@
 
 /* entry mask, shift */
 #define PRESENT_BIT_MASK 0b00000001
+#define PS_BIT_MASK 0b00000010  // PageMidDir 엔트리에서만: PageTable 대신 이어진 PageFrame 4 개 (superpage) 를 바로 가리킴
 #define PFN_MASK 0b11111100
 #define SPN_MASK 0b11111110
 #define PFN_SHIFT 2
 #define SPN_SHIFT 1
+#define PFN_LIMIT ((PFN_MASK >> PFN_SHIFT) + 1)  // PTE 에 담을 수 있는 pfn 의 개수
 
 /* page type */
 #define NOT_USED_TYPE -1
@@ -30,6 +48,88 @@
 #define PT_TYPE 3
 #define PF_TYPE 4
 
+/* swap readahead */
+#define RA_MAX_WINDOW 3  // PageTable 의 엔트리가 4 개이므로, 같은 PageTable 안의 이웃 페이지는 최대 3 개
+
+/* swap cluster */
+#define SWAP_CLUSTER_MAX 4  // 한 번에 함께 swap out 할 수 있는 페이지 수 (PageTable 하나가 가리키는 페이지 수)
+
+/* load control */
+#define LC_MAX_WAIT 8  // suspend 된 process 가 다른 process 와 자리를 바꿀 때까지 기다리는 최대 샘플 수
+
+/* snapshot */
+#define SNAP_MAGIC 0x50414e53554d4b55ULL  // "UKMUSNAP"
+#define SNAP_VERSION 3
+
+/* metadata scan */
+#define SCAN_SCALAR 0
+#define SCAN_SSE2 1
+#define SCAN_AVX2 2
+
+/* 주소 변환 구조 (ku_set_pt_mode 로 고르고, 다음 ku_mmu_init 부터 적용된다) */
+#define PT_RADIX 0  // process 마다 PageDir/PageMidDir/PageTable 3 단계 radix tree
+#define PT_HASHED 1  // 모든 process 가 함께 쓰는 (pid, vpn) 키의 hashed inverted page table
+
+/* paging-structure cache (PCB 마다 page walk 의 윗단 엔트리를 VA 상위 bit 로 캐시한다, direct-mapped) */
+#define PWC_PD 0  // PageDir 엔트리 cache (key: PD index -> PageMidDir 의 pfn)
+#define PWC_PMD 1  // PageMidDir 엔트리 cache (key: PD/PMD index -> PageTable 의 pfn)
+#define PWC_PD_SIZE 2
+#define PWC_PMD_SIZE 4
+#define WALK_REFS_MAX 3  // walk_cnt 의 마지막 칸 (radix 는 PD, PMD, PT 의 3 번이 최대, hashed 는 이 이상을 마지막 칸에 센다)
+
+/* page fault outcome */
+#define FAULT_MAPPED 0  // 이미 매핑되어 있었음
+#define FAULT_FIRST 1  // 처음 접근한 페이지에 PageFrame 을 할당 (PageMidDir/PageTable 은 이미 있었음)
+#define FAULT_TABLE 2  // PageMidDir/PageTable 까지 새로 할당하고 PageFrame 을 할당
+#define FAULT_SWAPIN 3  // 스왑된 페이지를 swap in
+#define FAULT_FAIL 4  // 처리하지 못함
+#define FAULT_NR 5
+
+/* addPage outcome */
+#define ADD_FREE 0  // free page 를 바로 얻음
+#define ADD_RECLAIM 1  // swap out 으로 자리를 만듦
+#define ADD_OOM 2  // 다른 process 를 OOM 으로 정리해서 자리를 만듦
+#define ADD_FAIL 3
+#define ADD_NR 4
+
+/* fault latency histogram (2 의 거듭제곱 구간마다 8 개씩 나눈 log-linear bucket, 오차 12.5% 이내) */
+#define LAT_SUB_BITS 3
+#define LAT_BUCKETS ((64 - LAT_SUB_BITS + 1) << LAT_SUB_BITS)
+
+/* hardware performance counter (ku_perf_start 로 켠 thread 의 page fault 마다 읽는다) */
+#define PERF_CYCLES 0
+#define PERF_INSTRUCTIONS 1
+#define PERF_CACHE_MISSES 2
+#define PERF_BRANCH_MISSES 3
+#define PERF_NR 4
+
+/* MMU event trace (KU_MMU_TRACE 를 정의하고 빌드했을 때만 기록된다) */
+#define EVENT_MAGIC "KUEVENT1"
+#define EVENT_VERSION 1
+#define EVENT_BUF_SIZE 4096  // thread 별 event buffer 에 모아 두는 event 수
+
+/* event type (a, b, x, y, data 의 의미) */
+#define EV_INIT 1  // ku_mmu_init (a: page 수, b: 스왑 페이지 수)
+#define EV_RESET 2  // ku_mmu_reset
+#define EV_FAULT_BEGIN 3  // ku_page_fault 시작 (x: va)
+#define EV_FAULT_END 4  // ku_page_fault 끝 (x: va, y: FAULT_* 결과)
+#define EV_RUN_PROC 5  // ku_run_proc (a: PageDir 의 pfn, y: 성공하면 0, 실패하면 1)
+#define EV_PROC_NEW 6  // pcb_list 에 PCB 추가
+#define EV_PROC_EXIT 7  // pcb_list 에서 PCB 제거
+#define EV_PAGE_ALLOC 8  // page 할당 (a: pfn, y: page type)
+#define EV_PAGE_FREE 9  // page free (a: pfn)
+#define EV_PAGE_DATA 10  // page 내용이 통째로 바뀜 (a: pfn, x: swap in 이면 1, data: 새 내용)
+#define EV_PTE 11  // PageDir/PageMidDir/PageTable 엔트리 갱신 (a: table 의 pfn, x: entry index, y: 새 엔트리)
+#define EV_PGF_ADD 12  // PageFrame 큐의 tail 에 추가 (a: pfn, b: PageTable 의 pfn, x: entry index, y: fadd)
+#define EV_PGF_DEL 13  // PageFrame 큐에서 제거 (a: pfn)
+#define EV_SWAP_SET 14  // 스왑 페이지에 저장 (a: spn, b: PageTable 의 pfn, x: entry index, y: fadd, data: 내용)
+#define EV_SWAP_USE 15  // 스왑 페이지의 사용 여부만 바뀜 (a: spn, y: 사용 중이면 1)
+#define EV_SWAP_FREE 16  // process 정리로 스왑 페이지 free (a: spn)
+#define EV_RECLAIM_BEGIN 17  // swapOutCluster 시작 (a: victim 의 pfn)
+#define EV_RECLAIM_END 18  // swapOutCluster 끝 (a: 내보낸 페이지 수)
+#define EV_PGF_SET 19  // 큐의 위치는 그대로 두고 PageFrame 을 가리키는 엔트리만 바뀜 (a: pfn, b: table 의 pfn, x: entry index)
+#define EV_NR 20
+
 
 
 
@@ -38,66 +138,24 @@ typedef struct page_ {
     char pte[4];
 } Page;
 
-/* 
-    page free info
-    : 페이지들이 free 한가를 판단하기 위한 정보를 저장한다.
-        - page: 해당 page 시작 주소
-        - type: page 의 타입 (PageDir/PageMidDir/PageTable/PageFrame)
-        - is_free: 해당 page 가 free 할 경우 1 아니면 0
-*/
-typedef struct page_free_info_ {
-    struct page_* page;
-    char type;
-    char is_free;
-} PFRI;
-
-/*
-    page frame info (node)
-    : PageFrame 을 swap 할 때 필요한 정보를 저장한다.
-        - page: 해당 page 시작 주소
-        - next: 다음 page (node 로 사용하기 위함)
-        - pid: 해당 page 에 접근한 process 의 id
-        - fadd: 해당 페이지가 대응하는 가상메모리 시작 주소 (first address)
-        - ladd: 해당 페이지가 대응하는 가상메모리 마지막 주소 (last address)
-*/
-typedef struct page_frame_info_ {
-    struct page_* page;
-    struct page_* pgtable;
-    struct page_frame_info_* next;
-    int pfn;
-    char ptenti;  // PT entry index
-    char pid;
-    unsigned char fadd;
-    unsigned char ladd;
-} PGF;
-
-/* 
-    page frame info queue
-    : PGF 를 노드로 하는 리스트 구조체
-*/
-typedef struct page_frame_info_queue_ {
-    struct page_frame_info_* head;
-    struct page_frame_info_* tail;
-    int len;
-} PGF_Queue;
-
 /*
     swap page info
-    : swap 공간에 배정될 page 들의 정보를 저장하는 구조체
-        - page: 해당 page 의 스왑공간 시작 주소
+    : swap in 할 스왑 페이지 하나의 내용과 정보를 복사해 두는 구조체
+      (스왑 페이지들의 정보 자체는 spn 으로 인덱싱되는 sp_* 배열들에 저장된다)
+        - page: 해당 스왑 페이지의 내용
+        - pgtable: 해당 페이지를 가리키던 PageTable 의 pfn
         - pid: 해당 page 에 접근한 process 의 id
         - fadd: 해당 페이지가 대응하는 가상메모리 시작 주소 (first address)
-        - ladd: 해당 페이지가 대응하는 가상메모리 마지막 주소 (last address)
+        - last_ref: swap out 되기 전에 마지막으로 참조가 확인된 샘플 번호
 */
 typedef struct swap_page_info_ {
-    struct page_* page;
-    struct page_* pgtable;
+    struct page_ page;
+    int pgtable;
     int spn;
     char ptenti;
     char pid;
     unsigned char fadd;
-    unsigned char ladd;
-    char is_free;
+    int last_ref;
 } SPI;
 
 /*
@@ -106,12 +164,37 @@ typedef struct swap_page_info_ {
         - pgdir: 해당 process 의 PageDir 시작 주소
         - next: 다음 PCB 시작 주소
         - pid: process id
+        - ra_win: 다음 swap in 때 함께 가져올 이웃 페이지 수 (readahead window)
+        - ra_lo, ra_hi: 직전 readahead 로 가져온 가상 페이지 번호(vpn) 범위 (없으면 -1)
+        - rss: 해당 process 가 사용 중인 PageFrame 수 (PageDir/PageMidDir/PageTable 포함)
+        - nswap: 해당 process 가 사용 중인 스왑 페이지 수
+        - rss_soft: reclaim 할 때 이 값을 넘은 process 의 페이지를 먼저 내보낸다 (0 이면 제한 없음)
+        - rss_max: rss 가 이 값에 닿으면 자신의 페이지를 내보내고 자리를 만든다 (0 이면 제한 없음)
+        - wss: 마지막 샘플에서 추정한 working set 크기 (PageFrame 수)
+        - prio: load control 에서 사용하는 우선순위 (작을수록 먼저 suspend 된다)
+        - suspended: load control 에 의해 suspend 되었으면 1
+        - lc_since: 마지막으로 suspend 되거나 다시 깨어난 샘플 번호
 */
 typedef struct pcb_ {
     struct page_* pgdir;
     // struct page_ **cr3;
     struct pcb_* next;
     char pid;
+    char ra_win;
+    int ra_lo;
+    int ra_hi;
+    int rss;
+    int nswap;
+    int rss_soft;
+    int rss_max;
+    int wss;
+    int prio;
+    char suspended;
+    int lc_since;
+    signed char pwc_pd_tag[PWC_PD_SIZE];  // cache 된 VA 의 PD index (-1 이면 비어있음)
+    unsigned char pwc_pd_pfn[PWC_PD_SIZE];
+    signed char pwc_pmd_tag[PWC_PMD_SIZE];  // cache 된 VA 의 PD/PMD index (-1 이면 비어있음)
+    unsigned char pwc_pmd_pfn[PWC_PMD_SIZE];
 } PCB;
 
 /*
@@ -124,13 +207,422 @@ typedef struct pcblist_ {
     int len;
 } PCB_List;
 
-int pfl_sz;  // pg_free_list 의 사이즈
-int spl_sz;  // sp_list 의 사이즈
-PFRI* pg_free_list;  // 물리 메모리 영역의 페이지들이 free 한 상태인지 여부가 담긴 배열 포인터
-SPI* sp_list;  // 스왑 영역의 페이지들의 정보를 담은 배열 포인터
-PGF_Queue* pgf_queue;  // 할당된 PageFrame 이 순서대로 저장된 단방향 연결리스트 포인터
+/*
+    snapshot 파일 헤더
+    : 헤더 뒤에 PCB_Snap 이 pcb_list 순서대로 npcb 개 오고, 그 뒤에 물리 메모리 (pmem_len 바이트),
+      스왑 공간 (smem_len 바이트), 메타데이터 영역 (meta_size 바이트) 이 각각 page 경계에 맞춰 저장된다.
+      물리 메모리와 스왑 공간은 사용된 적 있는 부분 (pf_hwm, sp_hwm 아래) 만 저장한다.
+*/
+typedef struct snap_header_ {
+    unsigned long long magic;
+    int version;
+    int npcb;
+    unsigned long long pmem_bytes, smem_bytes, meta_size;
+    unsigned long long pmem_off, smem_off, meta_off;
+    unsigned long long pmem_len, smem_len;
+    int pfl_sz, spl_sz, pf_hwm, sp_hwm, pgf_len, nr_free;
+    unsigned int vtime;
+    int ws_sample, oom_kills;
+    char oom_last_victim;
+    int ra_max, swap_cluster, ws_interval, ws_tau, load_control;
+    int pt_mode, superpage;
+} Snap_Header;
+
+/*
+    snapshot 에 저장되는 PCB (포인터 대신 pgdir 의 pfn 을 저장한다)
+*/
+typedef struct pcb_snap_ {
+    int pgdir;
+    char pid;
+    char ra_win;
+    int ra_lo, ra_hi, rss, nswap, rss_soft, rss_max, wss, prio;
+    char suspended;
+    int lc_since;
+} PCB_Snap;
+
+/*
+    출력 buffer
+    : 표 전체나 change log 를 여기에 모아서 한 번의 fwrite 로 출력한다. (한 번 늘어난 buffer 는 계속 재사용한다)
+*/
+typedef struct dump_buf_ {
+    char* s;
+    size_t len;
+    size_t cap;
+} Dump_Buf;
+
+/*
+    event trace 파일 헤더
+    : 헤더 뒤에 Event_Rec 이 이어진다. thread 마다 모아서 쓰기 때문에 파일 안의 순서는 seq 순서와 다를 수 있다.
+*/
+typedef struct event_header_ {
+    char magic[8];
+    unsigned int version;
+    unsigned int rec_size;
+} Event_Header;
+
+/*
+    MMU event (고정 크기 32 바이트)
+        - ts: 기록한 시각 (CLOCK_MONOTONIC, ns)
+        - seq: 모든 thread 에 걸친 기록 순서
+        - type: EV_*
+        - pid: 관련된 process 의 id
+        - x, y, a, b, data: type 별 인자
+*/
+typedef struct event_rec_ {
+    unsigned long long ts;
+    unsigned long long seq;
+    unsigned char type;
+    char pid;
+    unsigned char x;
+    unsigned char y;
+    int a;
+    int b;
+    char data[4];
+} Event_Rec;
+
+int pfl_sz;  // 물리 메모리의 page 수 (pf_* 배열들의 사이즈)
+int spl_sz;  // 스왑 공간의 page 수 (sp_* 배열들의 사이즈)
+Page* pmem_base;  // 물리 메모리 시작 주소 (pfn 번 page 는 pmem_base + pfn)
+Page* smem_base;  // 스왑 공간 시작 주소 (spn 번 스왑 페이지는 smem_base + spn)
+void* meta_base;  // pf_*, sp_* 배열들이 모여있는 영역의 시작 주소
+size_t meta_size;  // meta_base 영역의 크기
+size_t pmem_bytes;  // 물리 메모리 영역의 크기
+size_t smem_bytes;  // 스왑 공간의 크기
+int pf_hwm;  // 지금까지 사용된 적 있는 page 의 pfn 상한 (pfn < pf_hwm 인 page 만 건드려졌다)
+int sp_hwm;  // 지금까지 사용된 적 있는 스왑 페이지의 spn 상한
+
+/*
+    PageFrame 정보 (pfn 으로 인덱싱)
+    : 전체를 훑는 일이 많은 값들을 종류별로 따로 모아 둔 배열들 (0 번 page 는 사용하지 않는다)
+*/
+char* pf_type;  // page 의 타입 (PageDir/PageMidDir/PageTable/PageFrame)
+char* pf_used;  // 사용 중이면 1, free 할 경우 0 (0 으로 채워진 상태가 전부 free)
+char* pf_pid;  // 해당 page 를 사용하는 process 의 id
+char* pf_ref;  // 마지막 working set 샘플 이후 참조되었으면 1 (reference bit)
+int* pf_last_ref;  // 마지막으로 참조가 확인된 샘플 번호
+
+/*
+    스왑 페이지 정보 (spn 으로 인덱싱, 0 번 스왑 페이지는 사용하지 않는다)
+*/
+char* sp_used;  // 사용 중이면 1, free 할 경우 0 (0 으로 채워진 상태가 전부 free)
+char* sp_pid;  // 해당 page 에 접근한 process 의 id
+unsigned char* sp_fadd;  // 해당 페이지가 대응하는 가상메모리 시작 주소 (마지막 주소는 fadd + 3)
+int* sp_pgtable;  // 해당 페이지를 가리키던 PageTable 의 pfn
+char* sp_ptenti;  // 해당 페이지를 가리키던 PageTable 의 entry index
+int* sp_last_ref;  // swap out 되기 전에 마지막으로 참조가 확인된 샘플 번호
+
+/*
+    PageFrame 큐 (pfn 으로 인덱싱)
+    : 할당된 PageFrame 들을 할당된 순서대로 잇는 원형 이중 연결리스트.
+      사용하지 않는 0 번 page 를 sentinel 로 써서 pf_next[0] 이 가장 오래된 PageFrame, pf_prev[0] 이 가장 최근 PageFrame 이다.
+      PageFrame 을 swap 할 때 필요한 정보도 같은 pfn 으로 인덱싱해 둔다.
+*/
+int* pf_prev;  // 큐에서 이전 (더 오래된) PageFrame 의 pfn
+int* pf_next;  // 큐에서 다음 (더 최근) PageFrame 의 pfn
+int* pf_pgtable;  // 해당 PageFrame 을 가리키는 PageTable 의 pfn (superpage 에 속하면 PageMidDir 의 pfn)
+char* pf_ptenti;  // 해당 PageFrame 을 가리키는 PageTable 의 entry index (superpage 에 속하면 PageMidDir 의 entry index)
+unsigned char* pf_fadd;  // 해당 페이지가 대응하는 가상메모리 시작 주소 (마지막 주소는 fadd + 3)
+int pgf_len;  // 큐에 있는 PageFrame 의 수
+
+/*
+    hashed inverted page table (pt_mode 가 PT_HASHED 일 때만 메타데이터 영역에 만든다)
+    : (pid, vpn) 의 hash 로 bucket 을 고르고, bucket 에 걸린 PageFrame 들을 pf_hnext 로 잇는다.
+      키는 이미 PageFrame 마다 있는 pf_pid, pf_fadd 를 그대로 쓰므로 크기는 물리 메모리에만 비례한다. (0 이 빈 bucket/끝)
+*/
+int pt_mode = PT_RADIX;  // 지금 인스턴스의 주소 변환 구조
+int pt_mode_next = PT_RADIX;  // 다음 ku_mmu_init 이 쓸 주소 변환 구조
+int* ipt_head;  // bucket 별 첫 PageFrame 의 pfn (1 << ipt_bits 개)
+int* pf_hnext;  // 같은 bucket 의 다음 PageFrame 의 pfn (pfn 으로 인덱싱)
+int ipt_bits;
+
 PCB_List* pcb_list;  // ProcessControlBlock 단방향 연결리스트 포인터
+PCB* pcb_table[256];  // pid 로 PCB 를 바로 찾기 위한 테이블 (pcb_list 의 노드들을 가리킨다)
+PCB pcb_arena[256];  // pid 로 인덱싱되는 PCB 노드 배열
+SPI swap_buf;  // swap in 할 스왑 페이지를 잠시 복사해 두는 버퍼
+int ra_max = 0;  // swap in 할 때 함께 가져올 이웃 페이지 수의 상한 (0 이면 readahead 하지 않음)
+int swap_cluster = 1;  // swap out 할 때 같은 PageTable 의 페이지를 최대 몇 개까지 묶어서 내보낼지
+int nr_free;  // 현재 free 한 PageFrame 의 수
+int pwc_on = TRUE;  // page fault 의 page walk 에서 paging-structure cache 를 쓸지
+int superpage = FALSE;  // PageTable 이 이어진 PageFrame 들로 꽉 차면 PageMidDir 엔트리 하나로 매핑할지
+
+/* background reclaim (kswapd) */
+pthread_mutex_t mmu_lock = PTHREAD_MUTEX_INITIALIZER;  // ku_* 함수들과 kswapd 가 공유하는 MMU 전체 lock
+pthread_cond_t kswapd_wait = PTHREAD_COND_INITIALIZER;  // free page 가 low watermark 아래로 내려가면 kswapd 를 깨운다
+pthread_t kswapd_thread;
+int kswapd_running = FALSE;
+int wmark_low;  // free page 수가 이 값보다 작아지면 kswapd 가 reclaim 을 시작
+int wmark_high;  // kswapd 는 free page 수가 이 값이 될 때까지 reclaim 한다
+
+/* working set 추정 / load control */
+unsigned int vtime;  // 가상 시간 (메모리 접근 수. ku_reference 가 실패한 뒤 같은 접근의 ku_page_fault 는 세지 않는다)
+int ref_miss = -1;  // 마지막으로 실패한 ku_reference 의 (pid << 8 | va). 바로 뒤 같은 접근의 ku_page_fault 는 시간을 세지 않는다
+int ws_interval = 0;  // reference bit 를 샘플링하는 주기 (0 이면 working set 을 추정하지 않음)
+int ws_tau = 4;  // 최근 몇 번의 샘플 안에 참조된 페이지를 working set 으로 볼지
+int ws_sample;  // 지금까지의 샘플 횟수
+FILE* ws_log = NULL;  // 샘플마다 pid 별 working set 크기를 기록할 파일
+int load_control = FALSE;  // working set 합이 물리 메모리보다 크면 우선순위가 낮은 process 를 suspend
+
+/* metadata scan (pf_*, sp_* 바이트 배열을 훑는 커널) */
+int scanByteScalar(const char* a, int from, int n, char v, int eq);
+int countByteScalar(const char* a, int n, char v);
+int (*scan_byte)(const char*, int, int, char, int) = scanByteScalar;  // 현재 사용 중인 scan 커널
+int (*count_byte)(const char*, int, char) = countByteScalar;  // 현재 사용 중인 count 커널
+int scan_impl = SCAN_SCALAR;  // 현재 사용 중인 커널 종류 (SCAN_SCALAR/SCAN_SSE2/SCAN_AVX2)
+
+/* OOM */
+int oom_kills;  // OOM 으로 정리된 process 수
+char oom_last_victim;  // 마지막으로 OOM 으로 정리된 process 의 id
+
+/* 통계 (ku_mmu_init, ku_mmu_reset, ku_mmu_restore 에서 0 으로 초기화) */
+const char* fault_name[FAULT_NR] = { "mapped", "first_touch", "table_alloc", "swap_in", "fail" };
+unsigned long fault_cnt[FAULT_NR];  // ku_page_fault 의 결과별 호출 수
+unsigned long pid_fault_cnt[256][FAULT_NR];  // pid 별 fault_cnt
+unsigned long add_cnt[ADD_NR];  // addPage 의 결과별 호출 수
+unsigned long lat_hist[FAULT_NR][LAT_BUCKETS];  // fault 결과별 처리 시간 (ns) histogram
+unsigned long long lat_sum[FAULT_NR];  // fault 결과별 처리 시간 합 (ns)
+long long lat_max[FAULT_NR];  // fault 결과별 최대 처리 시간 (ns)
+unsigned long nr_swapin;  // swap in 된 페이지 수 (readahead 로 가져온 페이지 포함)
+unsigned long nr_swapout;  // swap out 된 페이지 수
+unsigned long nr_promote;  // PageTable 을 superpage 로 올린 수
+unsigned long nr_demote;  // 일부를 swap out 하려고 superpage 를 PageTable 로 되돌린 수
+unsigned long walk_cnt[WALK_REFS_MAX + 1];  // page fault 의 page walk 를 읽은 엔트리 수 (메모리 참조 수) 별로 센 수
+unsigned long long walk_refs;  // page fault 의 page walk 가 읽은 엔트리 수의 합
+unsigned long pwc_hit[2], pwc_miss[2];  // PWC_PD/PWC_PMD cache 의 hit, miss 수
+unsigned long perf_cnt[FAULT_NR];  // counter 를 읽은 page fault 의 결과별 수
+unsigned long long perf_sum[FAULT_NR][PERF_NR];  // fault 결과별 counter 증가량의 합
+
+/* hardware performance counter */
+const char* perf_name[PERF_NR] = { "cycles", "instructions", "cache_misses", "branch_misses" };
+int perf_fd[PERF_NR] = { -1, -1, -1, -1 };  // 열지 못한 counter 는 -1
+int perf_leader = -1;  // group leader 의 fd (꺼져 있으면 -1)
+int perf_pos[PERF_NR];  // group read 결과에서 counter 의 위치
+int perf_nr;  // 열린 counter 수
+int perf_mask;  // 마지막 ku_perf_start 에서 열린 counter 의 bit (ku_perf_stop 뒤에도 남는다)
+pthread_t perf_thread;  // counter 를 연 thread (이 thread 의 page fault 만 잰다)
+
+/*
+    change log (ku_dump_start 로 켜고, ku_dump_changes 가 출력한 뒤 비운다)
+    : page/스왑 페이지를 바꾸는 경로가 바뀐 pfn/spn 을 한 번씩만 목록에 넣어서, 출력 비용이 바뀐 양에 비례하게 한다.
+*/
+void* chg_base;  // 아래 배열들이 모여있는 영역 (꺼져 있으면 NULL)
+size_t chg_size;
+int* chg_pf;  // 마지막 dump 이후 바뀐 page 의 pfn 목록
+int* chg_sp;  // 마지막 dump 이후 바뀐 스왑 페이지의 spn 목록
+char* pf_dirty;  // chg_pf 에 들어있으면 1
+char* sp_dirty;  // chg_sp 에 들어있으면 1
+int nchg_pf, nchg_sp;
+int chg_seq;  // 지금까지 ku_dump_changes 를 호출한 횟수
+Dump_Buf dump_buf;
+
+
+
+
+long long getNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+    event trace
+    : KU_MMU_TRACE 없이 빌드하면 TRACE_EV 는 아무 코드도 만들지 않는다. (인자도 계산하지 않는다)
+      켜면 event 를 thread 별 buffer 에 모았다가, 가득 차거나 flush 할 때 한 번의 write 로 파일 끝에 붙인다.
+      ku_evdump 가 파일을 seq 순서로 읽어서 pt_* 출력과 같은 화면을 다시 만든다.
+*/
+#ifdef KU_MMU_TRACE
+int ev_fd = -1;  // event trace 파일 (열려있지 않으면 -1)
+unsigned long long ev_seq;  // 다음 event 의 seq
+__thread Event_Rec ev_buf[EVENT_BUF_SIZE];  // thread 별 event buffer
+__thread int ev_len;  // ev_buf 에 모인 event 수
+pthread_key_t ev_key;  // thread 가 끝날 때 ev_buf 를 flush 하기 위한 key
+pthread_once_t ev_once = PTHREAD_ONCE_INIT;
+
+/* timeline (Chrome Trace Event JSON, chrome://tracing 이나 ui.perfetto.dev 에서 연다) */
+#define TL_TRACK_CPU 0  // 실행 중인 process 를 보여주는 track
+#define TL_TRACK_DIRECT -1  // page fault 경로에서 한 reclaim
+#define TL_TRACK_KSWAPD -2  // kswapd 가 한 reclaim
+FILE* tl_fp = NULL;  // 열려있지 않으면 NULL
+long long tl_t0;  // timeline 의 0 시각 (ns)
+int tl_nev;  // 지금까지 쓴 JSON event 수
+char tl_named[256];  // pid 별 track 이름을 썼으면 1
+int tl_cur = -1;  // TL_TRACK_CPU 에서 실행 중인 pid (-1 이면 없음)
+long long tl_cur_ts;  // tl_cur 가 실행을 시작한 시각
+__thread long long tl_fault_ts;  // 처리 중인 page fault 의 시작 시각
+__thread long long tl_reclaim_ts;  // 처리 중인 reclaim 의 시작 시각
+__thread int tl_kswapd;  // kswapd thread 면 TRUE
+
+void flushEvents() {
+    /*
+        호출한 thread 의 event buffer 를 파일에 붙인다. (O_APPEND 라서 여러 thread 가 붙여도 서로 섞이지 않는다)
+    */
+    if (ev_fd >= 0 && ev_len) {
+        ssize_t n = write(ev_fd, ev_buf, sizeof(Event_Rec) * ev_len);
+        (void)n;
+    }
+    ev_len = 0;
+}
+
+void flushEventsAtExit(void* arg) {
+    (void)arg;
+    flushEvents();
+}
+
+void ku_mmu_trace_stop();
+void ku_mmu_timeline_stop();
+
+void createEventKey() {
+    pthread_key_create(&ev_key, flushEventsAtExit);
+    atexit(ku_mmu_trace_stop);  // main thread 는 key destructor 가 불리지 않으므로 종료할 때 flush
+    atexit(ku_mmu_timeline_stop);
+}
+
+void tlBegin(const char* ph, int tid, long long ts) {
+    /*
+        timeline JSON event 하나를 열고 공통 필드를 쓴다. (나머지 필드와 닫는 괄호는 호출한 쪽에서 쓴다)
+    */
+    fprintf(tl_fp, "%s{\"ph\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%.3f", tl_nev++ ? ",\n" : "", ph, tid, (ts - tl_t0) / 1e3);
+}
+
+void tlName(int tid, const char* name) {
+    tlBegin("M", tid, tl_t0);
+    fprintf(tl_fp, ",\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}", name);
+}
+
+void tlTrack(char pid) {
+    /*
+        pid 의 track 이름을 아직 쓰지 않았으면 쓴다.
+    */
+    char name[16];
+    if (tl_named[(unsigned char)pid]) return;
+    tl_named[(unsigned char)pid] = TRUE;
+    snprintf(name, sizeof(name), "pid %d", pid);
+    tlName((unsigned char)pid, name);
+}
+
+void tlRss(char pid, long long ts) {
+    PCB* pcb = pcb_table[(unsigned char)pid];
+    tlBegin("C", 0, ts);
+    fprintf(tl_fp, ",\"name\":\"rss pid %d\",\"args\":{\"pages\":%d}}", pid, pcb ? pcb->rss : 0);
+}
+
+void tlSwitch(int pid, long long ts) {
+    /*
+        TL_TRACK_CPU 에서 실행 중이던 process 의 구간을 닫고 pid 의 구간을 시작한다. (pid 가 -1 이면 닫기만 한다)
+    */
+    if (pid == tl_cur) return;
+    if (tl_cur >= 0) {
+        tlBegin("X", TL_TRACK_CPU, tl_cur_ts);
+        fprintf(tl_fp, ",\"dur\":%.3f,\"name\":\"pid %d\"}", (ts - tl_cur_ts) / 1e3, (char)tl_cur);
+    }
+    tl_cur = pid;
+    tl_cur_ts = ts;
+}
+
+void timelineEvent(const Event_Rec* ev) {
+    /*
+        MMU event 를 timeline JSON event 로 바꿔 쓴다.
+            - page fault: pid 별 track 에 결과별 이름의 구간
+            - swap in/out: pid 별 track 에 순간 event
+            - reclaim: direct reclaim/kswapd track 에 구간 (내보낸 페이지 수)
+            - ku_run_proc: cpu track 에 실행 중인 process 의 구간
+            - rss: pid 별 counter
+    */
+    long long ts = (long long)ev->ts;
+    int reclaim_tid = tl_kswapd ? TL_TRACK_KSWAPD : TL_TRACK_DIRECT;
+    switch (ev->type) {
+    case EV_FAULT_BEGIN:
+        tl_fault_ts = ts;
+        break;
+    case EV_FAULT_END:
+        tlTrack(ev->pid);
+        tlBegin("X", (unsigned char)ev->pid, tl_fault_ts);
+        fprintf(tl_fp, ",\"dur\":%.3f,\"name\":\"fault %s\",\"args\":{\"va\":%d}}",
+            (ts - tl_fault_ts) / 1e3, ev->y < FAULT_NR ? fault_name[ev->y] : "?", ev->x);
+        break;
+    case EV_RUN_PROC:
+        if (ev->y == 0) tlSwitch((unsigned char)ev->pid, ts);
+        break;
+    case EV_PAGE_DATA:
+        if (!ev->x) break;
+        tlTrack(ev->pid);
+        tlBegin("i", (unsigned char)ev->pid, ts);
+        fprintf(tl_fp, ",\"s\":\"t\",\"name\":\"swap in\",\"args\":{\"pfn\":%d}}", ev->a);
+        break;
+    case EV_SWAP_SET:
+        tlTrack(ev->pid);
+        tlBegin("i", (unsigned char)ev->pid, ts);
+        fprintf(tl_fp, ",\"s\":\"t\",\"name\":\"swap out\",\"args\":{\"spn\":%d,\"fadd\":%d}}", ev->a, ev->y);
+        break;
+    case EV_RECLAIM_BEGIN:
+        tl_reclaim_ts = ts;
+        break;
+    case EV_RECLAIM_END:
+        if (ev->a == 0) break;
+        tlBegin("X", reclaim_tid, tl_reclaim_ts);
+        fprintf(tl_fp, ",\"dur\":%.3f,\"name\":\"reclaim\",\"args\":{\"pages\":%d}}", (ts - tl_reclaim_ts) / 1e3, ev->a);
+        break;
+    case EV_PAGE_ALLOC:
+    case EV_PAGE_FREE:
+        tlRss(ev->pid, ts);
+        break;
+    case EV_PROC_EXIT:
+        tlRss(ev->pid, ts);
+        if (tl_cur == (unsigned char)ev->pid) tlSwitch(-1, ts);
+        break;
+    }
+}
+
+void traceEvent(int type, char pid, int x, int y, int a, int b, const Page* data) {
+    Event_Rec tmp;
+    Event_Rec* ev;
+    if (ev_fd < 0 && tl_fp == NULL) return;
+    if (ev_fd >= 0 && ev_len == 0) pthread_setspecific(ev_key, ev_buf);  // thread 가 끝날 때 남은 event 를 flush
+    ev = ev_fd >= 0 ? ev_buf + ev_len : &tmp;
+    ev->ts = getNs();
+    ev->seq = __atomic_fetch_add(&ev_seq, 1, __ATOMIC_RELAXED);
+    ev->type = type;
+    ev->pid = pid;
+    ev->x = x;
+    ev->y = y;
+    ev->a = a;
+    ev->b = b;
+    if (data) memcpy(ev->data, data->pte, 4);
+    else memset(ev->data, 0, 4);
+    if (tl_fp) timelineEvent(ev);
+    if (ev_fd >= 0 && ++ev_len == EVENT_BUF_SIZE) flushEvents();
+}
+
+#define TRACE_EV(type, pid, x, y, a, b, data) traceEvent(type, pid, x, y, a, b, data)
+#define TRACE_FLUSH() flushEvents()
+#else
+#define TRACE_EV(type, pid, x, y, a, b, data) ((void)0)
+#define TRACE_FLUSH() ((void)0)
+#endif
+
+void markPage(int pfn) {
+    /*
+        change log 가 켜져 있으면 pfn 번 page 가 바뀌었다고 기록한다.
+    */
+    if (chg_base && pfn > 0 && !pf_dirty[pfn]) {
+        pf_dirty[pfn] = TRUE;
+        chg_pf[nchg_pf++] = pfn;
+    }
+}
 
+void markSwap(int spn) {
+    if (chg_base && spn > 0 && !sp_dirty[spn]) {
+        sp_dirty[spn] = TRUE;
+        chg_sp[nchg_sp++] = spn;
+    }
+}
+
+void markAll(int np, int ns) {
+    /*
+        pfn < np 인 page 와 spn < ns 인 스왑 페이지를 모두 바뀐 것으로 기록한다.
+    */
+    for (int i = 1; i < np; ++i) markPage(i);
+    for (int i = 1; i < ns; ++i) markSwap(i);
+}
 
 
 
@@ -152,424 +644,1207 @@ void copyPage(Page* from, Page* to) {
     to->pte[3] = from->pte[3];
 }
 
+Page* getPage(int pfn) {
+    /*
+        pfn 번 page 의 시작 주소를 반환. (0 번 page 는 사용하지 않으므로 NULL 반환)
+    */
+    return pfn ? pmem_base + pfn : NULL;
+}
 
-
-
-/*
-    PGF 를 노드로 하는 PGF_Queue 를 다루기 위한 함수들
-*/
-PGF* createPGF(Page* page, Page* pgtable, int pfn, char ptenti, char pid, unsigned char add) {
-    PGF* pfi = (PGF *)malloc(sizeof(PGF));
-    pfi->page = page;
-    pfi->pgtable = pgtable;
-    pfi->pfn = pfn;
-    pfi->ptenti = ptenti;
-    pfi->pid = pid;
-    pfi->fadd = (add >> 2) << 2;
-    pfi->ladd = pfi->fadd + 3;
-    pfi->next = NULL;
-    return pfi;
-}
-
-PGF* addPGF(PGF_Queue* l, Page* page, Page* pgtable, int pfn, char ptenti, char pid, unsigned char add) {
-    PGF* pfi = createPGF(page, pgtable, pfn, ptenti, pid, add);
-    if (l->head == NULL) l->head = l->tail = pfi;
-    else {
-        l->tail->next = pfi;
-        l->tail = pfi;
-    }
-    l->len++;
-    return pfi;
+void* mapZero(size_t size) {
+    /*
+        size 바이트의 anonymous mmap 영역을 반환. (실패하면 NULL 반환)
+        커널이 처음 접근하는 page 부터 0 으로 채워주기 때문에, 크기와 상관없이 바로 반환된다.
+    */
+    void* p = mmap(NULL, size ? size : 1, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
 }
 
-PGF* popHeadPGF(PGF_Queue* l) {
-    PGF* curr = l->head;
-    if (curr == NULL) return NULL;
-    l->head = curr->next;
-    curr->next = NULL;
-    l->len--;
-    return curr;
+void unmapAll() {
+    /*
+        mapZero 로 할당한 물리 메모리, 스왑 공간, 메타데이터 영역을 모두 해제한다.
+    */
+    if (pmem_base) munmap(pmem_base, pmem_bytes ? pmem_bytes : 1);
+    if (smem_base) munmap(smem_base, smem_bytes ? smem_bytes : 1);
+    if (meta_base) munmap(meta_base, meta_size);
+    if (chg_base) munmap(chg_base, chg_size);
+    chg_base = NULL;
+    nchg_pf = nchg_sp = 0;
+    pmem_base = smem_base = NULL;
+    meta_base = NULL;
+    pfl_sz = spl_sz = nr_free = 0;
+    pf_hwm = sp_hwm = 0;
 }
 
-void insertHeadPGF(PGF_Queue* l, PGF* pgf) {
-    if (pgf == NULL) return;
-    pgf->next = l->head;
-    l->head = pgf;
-    l->len++;
+void* carveMeta(size_t* off, size_t size) {
+    /*
+        meta_base 영역의 *off 위치에서 size 바이트를 떼어 반환하고, *off 를 8 바이트 단위로 맞춰 옮긴다.
+    */
+    void* p = (char*)meta_base + *off;
+    *off += (size + 7) & ~(size_t)7;
+    return p;
 }
 
+void markReserved() {
+    /*
+        0 번 page 와 0 번 스왑 페이지는 사용하지 않으므로 사용 중으로 표시해 둔다.
+    */
+    if (pfl_sz) {
+        pf_type[0] = NOT_USED_TYPE;
+        pf_used[0] = TRUE;
+    }
+    if (spl_sz) sp_used[0] = TRUE;
+    pf_hwm = pfl_sz ? 1 : 0;
+    sp_hwm = spl_sz ? 1 : 0;
+}
 
+int iptBits(int npage) {
+    /*
+        npage 개의 page 를 담을 hashed inverted page table 의 bucket 수 (2 의 거듭제곱, page 수 이상) 의 log2
+    */
+    int bits = 0;
+    while ((1 << bits) < npage) bits++;
+    return bits;
+}
 
+size_t getMetaSize(int npage, int nswap, int mode) {
+    /*
+        npage 개의 page 와 nswap 개의 스왑 페이지에 필요한 메타데이터 영역의 크기 (배열 18 개의 정렬 여유분 포함)
+        mode 가 PT_HASHED 면 hashed inverted page table 도 들어간다.
+    */
+    size_t ipt = mode == PT_HASHED ? sizeof(int) * ((1 << iptBits(npage)) + npage) : 0;
+    return (sizeof(int) * 4 + 6) * npage + (sizeof(int) * 2 + 4) * nswap + ipt + 8 * 18;
+}
 
-/*
-    SPI 를 다루기 위한 함수들
-*/
-SPI* createSPI() {
-    SPI* spi = (SPI*)malloc(sizeof(SPI));
-    spi->page = (Page*)malloc(sizeof(Page));
-    return spi;
+void layoutMeta() {
+    /*
+        meta_base 영역을 pfl_sz, spl_sz 에 맞춰 pf_*, sp_* 배열들로 나눈다.
+        (snapshot 에서 복원할 때도 같은 배치를 쓰기 때문에, 배열 사이의 참조는 모두 pfn/spn 으로 저장한다)
+    */
+    int npage = pfl_sz, nswap = spl_sz;
+    size_t off = 0;
+    pf_last_ref = (int*)carveMeta(&off, sizeof(int) * npage);
+    pf_prev = (int*)carveMeta(&off, sizeof(int) * (npage ? npage : 1));  // 0 번 page 가 sentinel
+    pf_next = (int*)carveMeta(&off, sizeof(int) * (npage ? npage : 1));
+    pf_pgtable = (int*)carveMeta(&off, sizeof(int) * npage);
+    sp_pgtable = (int*)carveMeta(&off, sizeof(int) * nswap);
+    sp_last_ref = (int*)carveMeta(&off, sizeof(int) * nswap);
+    pf_type = (char*)carveMeta(&off, npage);
+    pf_used = (char*)carveMeta(&off, npage);
+    pf_pid = (char*)carveMeta(&off, npage);
+    pf_ref = (char*)carveMeta(&off, npage);
+    pf_ptenti = (char*)carveMeta(&off, npage);
+    pf_fadd = (unsigned char*)carveMeta(&off, npage);
+    sp_used = (char*)carveMeta(&off, nswap);
+    sp_pid = (char*)carveMeta(&off, nswap);
+    sp_fadd = (unsigned char*)carveMeta(&off, nswap);
+    sp_ptenti = (char*)carveMeta(&off, nswap);
+    ipt_head = pf_hnext = NULL;
+    if (pt_mode == PT_HASHED) {
+        ipt_bits = iptBits(npage);
+        ipt_head = (int*)carveMeta(&off, sizeof(int) << ipt_bits);
+        pf_hnext = (int*)carveMeta(&off, sizeof(int) * npage);
+    }
 }
 
-void copySPI(SPI* from, SPI* to) {
-    copyPage(from->page, to->page);
-    to->pgtable = from->pgtable;
-    to->spn = from->spn;
-    to->ptenti = from->ptenti;
-    to->pid = from->pid;
-    to->fadd = from->fadd;
-    to->ladd = from->ladd;
-    to->is_free = FALSE;
+Page* getSwapSpace(int spn) {
+    /*
+        spn 번 스왑 페이지의 시작 주소를 반환. (0 번 스왑 페이지는 사용하지 않으므로 NULL 반환)
+    */
+    return spn ? smem_base + spn : NULL;
 }
 
 
 
 
 /*
-    PCB 를 노드로 하는 PCB_List 를 다루기 위한 함수들
+    PageFrame/스왑 페이지 정보 바이트 배열을 훑는 함수들
+    : 같은 일을 하는 scalar/SSE2/AVX2 커널을 두고, setScanImpl 에서 CPU 가 지원하는 것으로 고른다.
+        - scanByte: [from, n) 에서 a[i] == v 인 (eq 가 FALSE 면 a[i] != v 인) 첫 i 를 반환. 없으면 n 반환
+        - countByte: [0, n) 에서 a[i] == v 인 i 의 수를 반환
 */
-PCB* createPCB(char pid) {
-    PCB* pcb = (PCB *)malloc(sizeof(PCB));
-    pcb->pid = pid;
-    pcb->pgdir = NULL;
-    pcb->next = NULL;
-    return pcb;
+int scanByteScalar(const char* a, int from, int n, char v, int eq) {
+    for (int i = from; i < n; ++i) {
+        if ((a[i] == v) == eq) return i;
+    }
+    return n;
 }
 
-PCB* addPCB(PCB_List* l, char pid) {
-    PCB* npcb = createPCB(pid);
-    if (l->head == NULL) l->head = l->tail = npcb;
-    else {
-        l->tail->next = npcb;
-        l->tail = npcb;
-    }
-    l->len++;
-    return npcb;
+int countByteScalar(const char* a, int n, char v) {
+    int cnt = 0;
+    for (int i = 0; i < n; ++i) cnt += (a[i] == v);
+    return cnt;
 }
 
-void removeTailPCB(PCB_List* l) {
-    PCB* curr = l->tail;
-    if (curr == NULL) return;
-    while (curr->next == l->tail) {
-        curr = curr->next;
+#ifdef KU_SCAN_X86
+__attribute__((target("sse2")))
+int scanByteSSE2(const char* a, int from, int n, char v, int eq) {
+    __m128i key = _mm_set1_epi8(v);
+    int i = from;
+    for (; i + 16 <= n; i += 16) {
+        unsigned m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(a + i)), key));
+        if (!eq) m = ~m & 0xffff;
+        if (m) return i + __builtin_ctz(m);
     }
-    curr->next = NULL;
-    free(l->tail);
-    l->tail = curr;
-    l->len--;
+    return scanByteScalar(a, i, n, v, eq);
 }
 
-PCB* searchPCB(PCB_List* l, char pid) {
-    PCB* curr = l->head;
-    while (curr != NULL) {
-        if (curr->pid == pid) return curr;
-        curr = curr->next;
-    }
-    return NULL;
+__attribute__((target("sse2,popcnt")))
+int countByteSSE2(const char* a, int n, char v) {
+    __m128i key = _mm_set1_epi8(v);
+    int i = 0, cnt = 0;
+    for (; i + 16 <= n; i += 16)
+        cnt += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(a + i)), key)));
+    return cnt + countByteScalar(a + i, n - i, v);
 }
 
-void freePCBList(PCB_List* l) {
-    PCB* curr = l->head;
-    PCB* temp;
-    while (curr != NULL) {
-        temp = curr;
-        curr = curr->next;
-        free(temp->pgdir);
-        free(temp);
+__attribute__((target("avx2")))
+int scanByteAVX2(const char* a, int from, int n, char v, int eq) {
+    __m256i key = _mm256_set1_epi8(v);
+    int i = from;
+    for (; i + 32 <= n; i += 32) {
+        unsigned m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + i)), key));
+        if (!eq) m = ~m;
+        if (m) return i + __builtin_ctz(m);
     }
+    return scanByteSSE2(a, i, n, v, eq);
 }
 
-
-
-
-/*
-    print 함수 
-*/
-void pt_entry(char ent) {
-    int p = ent & PRESENT_BIT_MASK;
-    int pfn = (ent & PFN_MASK) >> PFN_SHIFT;
-    int spn = (ent & SPN_MASK) >> SPN_SHIFT;
-    if (p || pfn || spn)
-        printf("(%d, %2d, %2d) ", p, pfn, spn);
-    else
-        printf("(         ) ");
+__attribute__((target("avx2,popcnt")))
+int countByteAVX2(const char* a, int n, char v) {
+    __m256i key = _mm256_set1_epi8(v);
+    int i = 0, cnt = 0;
+    for (; i + 32 <= n; i += 32)
+        cnt += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + i)), key)));
+    return cnt + countByteSSE2(a + i, n - i, v);
 }
+#endif
 
-void pt_pg_free_list() {
-    printf("  pg_free_list = [ \n");
-    for (int i = 0; i < pfl_sz; ++i) {
-        if (pg_free_list[i].page) 
-            printf("\t%2d (page: %p, ", i, pg_free_list[i].page);
-        else
-            printf("\t%2d (page: NULL,           ", i);
-        printf("type: %2d, ", pg_free_list[i].type);
-        printf("is_free: %d) ", pg_free_list[i].is_free);
-        if (pg_free_list[i].page) {
-            printf(
-                "entry: %2x %2x %2x %2x -> ", 
-                pg_free_list[i].page->pte[0],
-                pg_free_list[i].page->pte[1],
-                pg_free_list[i].page->pte[2],
-                pg_free_list[i].page->pte[3]
-            );
-            printf("p, pfn, spn: ");
-            pt_entry(pg_free_list[i].page->pte[0]);
-            pt_entry(pg_free_list[i].page->pte[1]);
-            pt_entry(pg_free_list[i].page->pte[2]);
-            pt_entry(pg_free_list[i].page->pte[3]);
-        }
-        else
-            printf("               ");
-        printf("\n");
+int setScanImpl(int level) {
+    /*
+        level 이하에서 CPU 가 지원하는 가장 빠른 커널을 고르고, 고른 커널 종류를 반환한다.
+    */
+    scan_byte = scanByteScalar;
+    count_byte = countByteScalar;
+    scan_impl = SCAN_SCALAR;
+#ifdef KU_SCAN_X86
+    __builtin_cpu_init();
+    if (level >= SCAN_AVX2 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        scan_byte = scanByteAVX2;
+        count_byte = countByteAVX2;
+        scan_impl = SCAN_AVX2;
     }
-    printf("  ]\n");
-}
-
-void pt_sp_list() {
-    printf("  sp_list = [ \n");
-    for (int i = 0; i < spl_sz; ++i) {
-        if (sp_list[i].page)
-            printf("\t%2d (page: %p, ", i, sp_list[i].page);
-        else
-            printf("\t%2d (page: NULL,           ", i);
-        printf("pid: %2d, ", sp_list[i].pid);
-        printf("fadd: %3d, ", sp_list[i].fadd);
-        printf("ladd: %3d, ", sp_list[i].ladd);
-        printf("is_free: %d) ", sp_list[i].is_free);
-        if (sp_list[i].page) {
-            printf(
-                "entry: %2x %2x %2x %2x -> ", 
-                sp_list[i].page->pte[0],
-                sp_list[i].page->pte[1],
-                sp_list[i].page->pte[2],
-                sp_list[i].page->pte[3]
-            );
-            printf("p, pfn, spn: ");
-            pt_entry(sp_list[i].page->pte[0]);
-            pt_entry(sp_list[i].page->pte[1]);
-            pt_entry(sp_list[i].page->pte[2]);
-            pt_entry(sp_list[i].page->pte[3]);
-        }
-        else
-            printf("\t\t\t\t\t\t\t\t\t              ");
-        if (sp_list[i].pgtable) {
-            printf("(pgtable: %p, ", sp_list[i].pgtable);
-            printf("ptenti: %d, ", sp_list[i].ptenti);
-            printf("pgtable entry: %2x)", sp_list[i].pgtable->pte[(int)sp_list[i].ptenti]);
-        }
-        else
-            printf("(pgtable: NULL)");
-        printf("\n");
+    else if (level >= SCAN_SSE2 && __builtin_cpu_supports("sse2") && __builtin_cpu_supports("popcnt")) {
+        scan_byte = scanByteSSE2;
+        count_byte = countByteSSE2;
+        scan_impl = SCAN_SSE2;
     }
-    printf("  ]\n");
+#endif
+    return scan_impl;
 }
 
-void pt_pgf_queue() {
-    PGF* curr = pgf_queue->head;
-    int i = 0;
-    printf("  pgf_queue = [");
-    if (curr) printf("\n");
-    while (curr != NULL) {
-        if (curr->page)
-            printf("\t%2d (page: %p, ", i, curr->page);
-        else
-            printf("\t%2d (page: NULL,           ", i);
-        printf("pid: %2d, ", curr->pid);
-        printf("fadd: %3d, ", curr->fadd);
-        printf("ladd: %3d, ", curr->ladd);
-        printf("pfn: %2d) ", curr->pfn);
-        if (curr->page) {
-            printf(
-                "entry: %2x %2x %2x %2x -> ", 
-                curr->page->pte[0],
-                curr->page->pte[1],
-                curr->page->pte[2],
-                curr->page->pte[3]
-            );
-            printf("p, pfn, spn: ");
-            pt_entry(curr->page->pte[0]);
-            pt_entry(curr->page->pte[1]);
-            pt_entry(curr->page->pte[2]);
-            pt_entry(curr->page->pte[3]);
-        }
-        else
-            printf("               ");
-        if (curr->pgtable) {
-            printf("(pgtable: %p, ", curr->pgtable);
-            printf("ptenti: %d, ", curr->ptenti);
-            printf("pgtable entry: %2x)", curr->pgtable->pte[(int)curr->ptenti]);
-        }
-        else
-            printf("(pgtable: NULL)          ");
-        printf("\n");
-        i++;
-        curr = curr->next;
-    }
-    printf("  ]\n");
+int findByte(const char* a, int from, int n, char v) {
+    return scan_byte(a, from, n, v, TRUE);
 }
 
-void pt_pcb_list() {
-    PCB* curr = pcb_list->head;
-    int i = 0;
-    printf("  pcb_list = [");
-    if (curr) printf("\n");
-    while (curr != NULL) {
-        printf("\t%2d (pgdir: %p, ", i, curr->pgdir);
-        printf("pid: %2d)\n", curr->pid);
-        i++;
-        curr = curr->next;
-    }
-    printf("  ]\n");
+int findOtherByte(const char* a, int from, int n, char v) {
+    return scan_byte(a, from, n, v, FALSE);
 }
 
 
 
 
 /*
-    메인 함수에 반복적으로 필요한 기능을 모듈화한 함수들
+    pf_prev/pf_next 로 이루어진 PageFrame 큐를 다루기 위한 함수들 (모두 O(1), 할당 없음)
 */
-int getFreePage(char type) {
+void linkPGF(int pfn, int prev) {
     /*
-        : pg_free_list 를 순회하면서, Free Page 가 있으면 해당 page 의 시작 주소를 반환하고
-        없으면 NULL 을 반환하는 함수
-        
-        type: 반환될 page가 사용될 타입 (PageDir/PageMidDir/PageTable/PageFrame)
-
-        pg_free_list 순회하면서
-            - free page 가 있으면
-                - pg_free_list[i].type = type
-                - pg_free_list[i].is_free = FALSE
-                - return pg_free_list[i].page
-            - free page 가 없으면 
-                - return NULL
+        pfn 을 큐의 prev 바로 뒤에 끼워 넣는다.
     */
-    for (int i = 1; i < pfl_sz; ++i) {
-        if (pg_free_list[i].is_free) {
-            pg_free_list[i].type = type;
-            pg_free_list[i].is_free = FALSE;
-            return i;
-        }
-    }
-    return 0;
+    int next = pf_next[prev];
+    pf_prev[pfn] = prev;
+    pf_next[pfn] = next;
+    pf_next[prev] = pfn;
+    pf_prev[next] = pfn;
+    pgf_len++;
 }
 
-PGF* getPageFrame() {
+void addPGF(int pfn, int pgtable, char ptenti, unsigned char add) {
     /*
-        pgf_queue 의 head 를 반환하는 함수 (형식을 맞추기 위해 사용)
+        pfn 번 PageFrame 의 정보를 저장하고 큐의 tail (가장 최근) 에 넣는다.
     */
-    return pgf_queue->head;
+    pf_pgtable[pfn] = pgtable;
+    pf_ptenti[pfn] = ptenti;
+    pf_fadd[pfn] = (add >> 2) << 2;
+    linkPGF(pfn, pf_prev[0]);
+    markPage(pfn);
+    TRACE_EV(EV_PGF_ADD, pf_pid[pfn], ptenti, pf_fadd[pfn], pfn, pgtable, NULL);
 }
 
-SPI* getFreeSwapPage() {
+void removePGF(int pfn) {
     /*
-        스왑 영역의 남는 페이지를 SPI 타입으로 반환
+        pfn 번 PageFrame 을 큐의 어느 위치에 있든 바로 빼낸다.
     */
-    for (int i = 1; i < spl_sz; ++i) {
-        if (sp_list[i].is_free) return sp_list + i;
-    }
-    return NULL;
+    pf_next[pf_prev[pfn]] = pf_next[pfn];
+    pf_prev[pf_next[pfn]] = pf_prev[pfn];
+    pf_prev[pfn] = pf_next[pfn] = pfn;
+    pgf_len--;
+    markPage(pfn);
+    TRACE_EV(EV_PGF_DEL, pf_pid[pfn], 0, 0, pfn, 0, NULL);
 }
 
-SPI* getSwapPage(char pid, unsigned char add) {
+void setPGF(int pfn, int pgtable, char ptenti) {
     /*
-        (pid, address) 쌍에 부합하는 스왑페이지가 있으면 반환. 없으면 NULL 반환
+        pfn 번 PageFrame 을 가리키는 엔트리만 바꾼다. (superpage 로 올리거나 되돌릴 때, 큐의 위치는 그대로)
     */
-    SPI* spi = createSPI();
-    for (int i = 1; i < spl_sz; ++i) {
-        if (sp_list[i].pid == pid) {
-            if (sp_list[i].fadd <= add && add <= sp_list[i].ladd) {
-                sp_list[i].is_free = TRUE;
-                copySPI(sp_list + i, spi);
-                return spi;
-            }
-        }
-    }
-    return NULL;
+    pf_pgtable[pfn] = pgtable;
+    pf_ptenti[pfn] = ptenti;
+    markPage(pfn);
+    TRACE_EV(EV_PGF_SET, pf_pid[pfn], ptenti, 0, pfn, pgtable, NULL);
 }
 
-void swapIn(SPI* spi, int pfn) {
+int popHeadPGF() {
     /*
-        스왑 페이지의 정보를 pg_free_list 에 저장한다.
-        해당 페이지와 관련된 PageFrame 과 PageTable 의 정보도 갱신한다.
+        큐의 head (가장 오래된) PageFrame 을 빼서 pfn 을 반환. 비어있으면 0 반환
     */
-    // page 내용 복사
-    Page* page = pg_free_list[pfn].page;
-    copyPage(spi->page, page);
-    // PF 업데이트
-    addPGF(pgf_queue, page, spi->pgtable, pfn, spi->ptenti, spi->pid, spi->fadd);
-    // PT 업데이트
-    spi->pgtable->pte[(int)spi->ptenti] = (pfn << 2) + PRESENT_BIT_MASK;
+    int pfn = pf_next[0];
+    if (pfn) removePGF(pfn);
+    return pfn;
 }
 
-void swapOut(PGF* pgf, SPI* spi) {    
-    /*
-        PageFrame 정보를 스왑 페이지에 저장.
-        관련된 PageTable 을 갱신하고, PageFrame 구조체 포인터를 free 한다.
-    */
-    // swap 공간에 복사
-    copyPage(pgf->page, spi->page);
-    spi->pgtable = pgf->pgtable;
-    spi->ptenti = pgf->ptenti;
-    spi->pid = pgf->pid;
-    spi->fadd = pgf->fadd;
-    spi->ladd = pgf->ladd;
-    spi->is_free = FALSE;
-    // pgf 의 page 초기화
-    setZeroPage(pgf->page);
-    pgf->pgtable->pte[(int)pgf->ptenti] = (spi->spn << SPN_SHIFT);
-    free(pgf);
+void insertHeadPGF(int pfn) {
+    if (pfn) linkPGF(pfn, 0);
 }
 
 
 
 
 /*
-    ku_mmc.h 의 핵심 함수들
+    hashed inverted page table 을 다루기 위한 함수들
 */
-int addPage(char type) {
+int iptHash(char pid, int vpn) {
+    unsigned int key = ((unsigned int)(unsigned char)pid << 6) | vpn;
+    return (int)((key * 0x9E3779B1u) >> (32 - ipt_bits)) & ((1 << ipt_bits) - 1);
+}
+
+int iptLookup(char pid, unsigned char va, int* refs) {
     /*
-        free page 나, 스왑 가능한 page 를 알아서 처리후 사용 가능한 page 의 pfn 반환.
-        사용 가능한 page 가 없을 경우 0 반환. 
-        (page[0] 은 NULL 값으로 초기화되어 있고, 그 후에 변경되지 않기 때문에, 나중에 fail 처리가 가능)
+        (pid, va 의 vpn) 이 매핑된 PageFrame 의 pfn 을 반환한다. (없으면 0)
+        refs 가 NULL 이 아니면 읽은 엔트리 수 (bucket 하나 + 비교한 PageFrame 수) 를 넣는다.
     */
-    int pfn = getFreePage(type);
-    Page* npage = pg_free_list[pfn].page;
-    SPI* spi = getFreeSwapPage();
-    PGF* pgf = getPageFrame();
-    // free page 가 있을 때
-    if (npage) {
-        setZeroPage(npage);
-    }
-    // PageFrame 이나 SwapSpace 중 하나라도 없으면 fail
-    else if (pgf == NULL || spi == NULL) return 0;  // fail
-    // PageFrame 과 SwapSpace 둘 다 있을 때
-    else {
-        popHeadPGF(pgf_queue);
-        swapOut(pgf, spi);
-        pfn = pgf->pfn;
-        pg_free_list[pfn].type = type;
+    int vpn = va >> PT_SHIFT, n = 0;
+    int pfn = ipt_head[iptHash(pid, vpn)];
+    for (; pfn; pfn = pf_hnext[pfn]) {
+        n++;
+        if (pf_pid[pfn] == pid && (pf_fadd[pfn] >> PT_SHIFT) == vpn) break;
     }
+    if (refs) *refs = 1 + n;
     return pfn;
 }
 
-int ku_page_fault (char pid, unsigned char va) {
+void iptInsert(int pfn) {
     /*
-        pid: page fault 가 발생한 프로세스의 id
-        va: page fault 가 발생한 Virtual Address
+        pf_pid, pf_fadd 가 정해진 pfn 번 PageFrame 을 bucket 의 맨 앞에 건다.
+    */
+    int* head = ipt_head + iptHash(pf_pid[pfn], pf_fadd[pfn] >> PT_SHIFT);
+    pf_hnext[pfn] = *head;
+    *head = pfn;
+}
 
-        전제조건
-            - pid 의 process 가 돌아가고 있고
-            - va 접근이 page fault 가 난 상태
+void iptRemove(int pfn) {
+    int* link = ipt_head + iptHash(pf_pid[pfn], pf_fadd[pfn] >> PT_SHIFT);
+    while (*link && *link != pfn) link = pf_hnext + *link;
+    if (*link) *link = pf_hnext[pfn];
+    pf_hnext[pfn] = 0;
+}
 
-        - 접근하려는 주소: 11 00 10 11
-        - PageDir index: 11
-        - PageMidDir index: 00
+
+
+/*
+    SPI 를 다루기 위한 함수들
+*/
+SPI* createSPI() {
+    /*
+        swap in 할 스왑 페이지를 복사해 둘 SPI 를 반환 (미리 할당된 swap_buf 를 재사용한다)
+    */
+    return &swap_buf;
+}
+
+void copySPI(int spn, SPI* to) {
+    /*
+        spn 번 스왑 페이지의 내용과 정보를 to 에 복사한다.
+    */
+    copyPage(getSwapSpace(spn), &to->page);
+    to->pgtable = sp_pgtable[spn];
+    to->spn = spn;
+    to->ptenti = sp_ptenti[spn];
+    to->pid = sp_pid[spn];
+    to->fadd = sp_fadd[spn];
+    to->last_ref = sp_last_ref[spn];
+}
+
+
+
+
+/*
+    PCB 를 노드로 하는 PCB_List 를 다루기 위한 함수들
+*/
+PCB* createPCB(char pid) {
+    PCB* pcb = pcb_arena + (unsigned char)pid;
+    pcb->pid = pid;
+    pcb->pgdir = NULL;
+    pcb->next = NULL;
+    pcb->ra_win = 1;
+    pcb->ra_lo = -1;
+    pcb->ra_hi = -1;
+    pcb->rss = 0;
+    pcb->nswap = 0;
+    pcb->rss_soft = 0;
+    pcb->rss_max = 0;
+    pcb->wss = 0;
+    pcb->prio = 0;
+    pcb->suspended = FALSE;
+    pcb->lc_since = 0;
+    memset(pcb->pwc_pd_tag, -1, sizeof(pcb->pwc_pd_tag));
+    memset(pcb->pwc_pmd_tag, -1, sizeof(pcb->pwc_pmd_tag));
+    return pcb;
+}
+
+PCB* addPCB(PCB_List* l, char pid) {
+    PCB* npcb = createPCB(pid);
+    if (l->head == NULL) l->head = l->tail = npcb;
+    else {
+        l->tail->next = npcb;
+        l->tail = npcb;
+    }
+    l->len++;
+    pcb_table[(unsigned char)pid] = npcb;
+    return npcb;
+}
+
+void removePCB(PCB_List* l, PCB* pcb) {
+    PCB* prev = NULL;
+    PCB* curr = l->head;
+    while (curr != NULL && curr != pcb) {
+        prev = curr;
+        curr = curr->next;
+    }
+    if (curr == NULL) return;
+    if (prev) prev->next = curr->next;
+    else l->head = curr->next;
+    if (l->tail == curr) l->tail = prev;
+    pcb_table[(unsigned char)curr->pid] = NULL;
+    l->len--;
+}
+
+void removeTailPCB(PCB_List* l) {
+    PCB* curr = l->tail;
+    if (curr == NULL) return;
+    while (curr->next == l->tail) {
+        curr = curr->next;
+    }
+    curr->next = NULL;
+    pcb_table[(unsigned char)l->tail->pid] = NULL;
+    l->tail = curr;
+    l->len--;
+}
+
+PCB* searchPCB(char pid) {
+    return pcb_table[(unsigned char)pid];
+}
+
+void freePCBList(PCB_List* l) {
+    PCB* curr = l->head;
+    PCB* temp;
+    while (curr != NULL) {
+        temp = curr;
+        curr = curr->next;
+        pcb_table[(unsigned char)temp->pid] = NULL;
+    }
+    l->head = l->tail = NULL;
+    l->len = 0;
+}
+
+/*
+    paging-structure cache
+    : PageDir/PageMidDir 엔트리를 pid 별로 캐시해서, page walk 가 hit 한 단계부터 시작해 마지막 단계만 다시 읽게 한다.
+      cache 에는 present 인 엔트리만 들어가고, 엔트리가 바뀌면 pwcFill 로 덮어쓰고, table 이 free 되면 pwcFlush 로 지운다.
+      (PageMidDir/PageTable 은 swap out 되지 않으므로 table 이 free 되는 것은 process 가 정리될 때뿐이다)
+*/
+void pwcFlush(PCB* pcb) {
+    memset(pcb->pwc_pd_tag, -1, sizeof(pcb->pwc_pd_tag));
+    memset(pcb->pwc_pmd_tag, -1, sizeof(pcb->pwc_pmd_tag));
+}
+
+void pwcFill(PCB* pcb, int level, unsigned char va, int pfn) {
+    /*
+        level (PWC_PD/PWC_PMD) 단계에서 va 가 따라간 엔트리가 pfn 번 table 을 가리킨다고 기록한다.
+    */
+    if (level == PWC_PD) {
+        int tag = va >> PD_SHIFT;
+        pcb->pwc_pd_tag[tag & (PWC_PD_SIZE - 1)] = tag;
+        pcb->pwc_pd_pfn[tag & (PWC_PD_SIZE - 1)] = pfn;
+    }
+    else {
+        int tag = va >> PMD_SHIFT;
+        pcb->pwc_pmd_tag[tag & (PWC_PMD_SIZE - 1)] = tag;
+        pcb->pwc_pmd_pfn[tag & (PWC_PMD_SIZE - 1)] = pfn;
+    }
+}
+
+void pwcInvalidate(PCB* pcb, unsigned char va) {
+    /*
+        va 의 PageMidDir 엔트리가 더 이상 PageTable 을 가리키지 않으면 (superpage 로 올라가면) cache 에서 지운다.
+    */
+    int tag = va >> PMD_SHIFT;
+    if (pcb->pwc_pmd_tag[tag & (PWC_PMD_SIZE - 1)] == tag) pcb->pwc_pmd_tag[tag & (PWC_PMD_SIZE - 1)] = -1;
+}
+
+int pwcLookup(PCB* pcb, unsigned char va, Page** lpage) {
+    /*
+        va 의 page walk 를 시작할 단계 (0: PageDir, 1: PageMidDir, 2: PageTable) 와 그 단계의 table 을 lpage 에 돌려준다.
+        PageMidDir 엔트리 cache 를 먼저 보고, miss 면 PageDir 엔트리 cache 를 본다.
+    */
+    int tag = va >> PMD_SHIFT, pd = va >> PD_SHIFT;
+    if (pcb->pwc_pmd_tag[tag & (PWC_PMD_SIZE - 1)] == tag) {
+        pwc_hit[PWC_PMD]++;
+        *lpage = getPage(pcb->pwc_pmd_pfn[tag & (PWC_PMD_SIZE - 1)]);
+        return 2;
+    }
+    pwc_miss[PWC_PMD]++;
+    if (pcb->pwc_pd_tag[pd & (PWC_PD_SIZE - 1)] == pd) {
+        pwc_hit[PWC_PD]++;
+        *lpage = getPage(pcb->pwc_pd_pfn[pd & (PWC_PD_SIZE - 1)]);
+        return 1;
+    }
+    pwc_miss[PWC_PD]++;
+    *lpage = pcb->pgdir;
+    return 0;
+}
+
+
+
+
+#ifdef KU_MMU_TRACE
+void traceState() {
+    /*
+        trace 를 중간에 시작했을 때, ku_evdump 가 같은 상태에서 출발할 수 있도록 현재 상태를 event 로 기록한다.
+    */
+    traceEvent(EV_INIT, 0, 0, 0, pfl_sz, spl_sz, NULL);
+    for (PCB* pcb = pcb_list->head; pcb != NULL; pcb = pcb->next)
+        traceEvent(EV_PROC_NEW, pcb->pid, 0, 0, pcb->pgdir ? pcb->pgdir - pmem_base : 0, 0, NULL);
+    for (int i = 1; i < pf_hwm; ++i) {
+        if (!pf_used[i]) continue;
+        traceEvent(EV_PAGE_ALLOC, pf_pid[i], 0, pf_type[i], i, 0, NULL);
+        traceEvent(EV_PAGE_DATA, pf_pid[i], 0, 0, i, 0, getPage(i));
+    }
+    for (int curr = pf_next[0]; curr != 0; curr = pf_next[curr])
+        traceEvent(EV_PGF_ADD, pf_pid[curr], pf_ptenti[curr], pf_fadd[curr], curr, pf_pgtable[curr], NULL);
+    // free 스왑 페이지도 마지막으로 저장된 정보가 남아있으므로 같이 기록한다
+    for (int i = 1; i < sp_hwm; ++i) {
+        traceEvent(EV_SWAP_SET, sp_pid[i], sp_ptenti[i], sp_fadd[i], i, sp_pgtable[i], getSwapSpace(i));
+        if (!sp_used[i]) traceEvent(EV_SWAP_USE, sp_pid[i], 0, FALSE, i, 0, NULL);
+    }
+}
+#endif
+
+
+
+
+/*
+    print 함수 
+    : 한 줄씩 Dump_Buf 에 만들어 두고 표가 끝나면 한 번에 출력한다.
+*/
+void bufPrintf(Dump_Buf* b, const char* fmt, ...) {
+    va_list ap;
+    int n;
+    va_start(ap, fmt);
+    n = vsnprintf(b->cap ? b->s + b->len : NULL, b->cap - b->len, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if (b->len + n + 1 > b->cap) {
+        size_t cap = b->cap ? b->cap * 2 : 4096;
+        char* s;
+        while (cap < b->len + n + 1) cap *= 2;
+        if ((s = (char*)realloc(b->s, cap)) == NULL) return;
+        b->s = s;
+        b->cap = cap;
+        va_start(ap, fmt);
+        vsnprintf(b->s + b->len, b->cap - b->len, fmt, ap);
+        va_end(ap);
+    }
+    b->len += n;
+}
+
+void bufWrite(Dump_Buf* b, FILE* fp) {
+    if (b->len) fwrite(b->s, 1, b->len, fp);
+    b->len = 0;
+}
+
+void fmtEntry(Dump_Buf* b, char ent) {
+    int p = ent & PRESENT_BIT_MASK;
+    int pfn = (ent & PFN_MASK) >> PFN_SHIFT;
+    int spn = (ent & SPN_MASK) >> SPN_SHIFT;
+    if (p || pfn || spn)
+        bufPrintf(b, "(%d, %2d, %2d) ", p, pfn, spn);
+    else
+        bufPrintf(b, "(         ) ");
+}
+
+void fmtEntries(Dump_Buf* b, Page* page) {
+    bufPrintf(b, "entry: %2x %2x %2x %2x -> ", page->pte[0], page->pte[1], page->pte[2], page->pte[3]);
+    bufPrintf(b, "p, pfn, spn: ");
+    for (int k = 0; k < 4; ++k) fmtEntry(b, page->pte[k]);
+}
+
+void fmtPageRow(Dump_Buf* b, int i) {
+    Page* page = getPage(i);
+    if (page)
+        bufPrintf(b, "\t%2d (page: %p, ", i, (void*)page);
+    else
+        bufPrintf(b, "\t%2d (page: NULL,           ", i);
+    bufPrintf(b, "type: %2d, is_free: %d) ", pf_type[i], !pf_used[i]);
+    if (page) fmtEntries(b, page);
+    else bufPrintf(b, "               ");
+    bufPrintf(b, "\n");
+}
+
+void fmtSwapRow(Dump_Buf* b, int i) {
+    Page* page = getSwapSpace(i);
+    Page* pgtable = getPage(sp_pgtable[i]);
+    if (page)
+        bufPrintf(b, "\t%2d (page: %p, ", i, (void*)page);
+    else
+        bufPrintf(b, "\t%2d (page: NULL,           ", i);
+    bufPrintf(b, "pid: %2d, fadd: %3d, ladd: %3d, is_free: %d) ", sp_pid[i], sp_fadd[i], sp_fadd[i] + 3, !sp_used[i]);
+    if (page) fmtEntries(b, page);
+    else bufPrintf(b, "\t\t\t\t\t\t\t\t\t              ");
+    if (pgtable)
+        bufPrintf(b, "(pgtable: %p, ptenti: %d, pgtable entry: %2x)", (void*)pgtable, sp_ptenti[i], pgtable->pte[(int)sp_ptenti[i]]);
+    else
+        bufPrintf(b, "(pgtable: NULL)");
+    bufPrintf(b, "\n");
+}
+
+void fmtQueueRow(Dump_Buf* b, int i, int pfn) {
+    /*
+        PageFrame 큐의 i 번째 (i 가 -1 이면 위치를 모름) PageFrame 한 줄
+    */
+    Page* page = getPage(pfn);
+    Page* pgtable = getPage(pf_pgtable[pfn]);
+    if (i < 0) bufPrintf(b, "\t * ");
+    else bufPrintf(b, "\t%2d ", i);
+    bufPrintf(b, "(page: %p, pid: %2d, fadd: %3d, ladd: %3d, pfn: %2d) ", (void*)page, pf_pid[pfn], pf_fadd[pfn], pf_fadd[pfn] + 3, pfn);
+    fmtEntries(b, page);
+    if (pgtable)
+        bufPrintf(b, "(pgtable: %p, ptenti: %d, pgtable entry: %2x)", (void*)pgtable, pf_ptenti[pfn], pgtable->pte[(int)pf_ptenti[pfn]]);
+    else
+        bufPrintf(b, "(pgtable: NULL)          ");
+    bufPrintf(b, "\n");
+}
+
+void pt_entry(char ent) {
+    fmtEntry(&dump_buf, ent);
+    bufWrite(&dump_buf, stdout);
+}
+
+void pt_pg_free_list() {
+    bufPrintf(&dump_buf, "  pg_free_list = [ \n");
+    for (int i = 0; i < pfl_sz; ++i) fmtPageRow(&dump_buf, i);
+    bufPrintf(&dump_buf, "  ]\n");
+    bufWrite(&dump_buf, stdout);
+}
+
+void pt_sp_list() {
+    bufPrintf(&dump_buf, "  sp_list = [ \n");
+    for (int i = 0; i < spl_sz; ++i) fmtSwapRow(&dump_buf, i);
+    bufPrintf(&dump_buf, "  ]\n");
+    bufWrite(&dump_buf, stdout);
+}
+
+void pt_pgf_queue() {
+    int i = 0;
+    bufPrintf(&dump_buf, "  pgf_queue = [");
+    if (pf_next[0]) bufPrintf(&dump_buf, "\n");
+    for (int curr = pf_next[0]; curr != 0; curr = pf_next[curr]) fmtQueueRow(&dump_buf, i++, curr);
+    bufPrintf(&dump_buf, "  ]\n");
+    bufWrite(&dump_buf, stdout);
+}
+
+void pt_pcb_list() {
+    PCB* curr = pcb_list->head;
+    int i = 0;
+    bufPrintf(&dump_buf, "  pcb_list = [");
+    if (curr) bufPrintf(&dump_buf, "\n");
+    while (curr != NULL) {
+        bufPrintf(&dump_buf, "\t%2d (pgdir: %p, pid: %2d)\n", i, (void*)curr->pgdir, curr->pid);
+        i++;
+        curr = curr->next;
+    }
+    bufPrintf(&dump_buf, "  ]\n");
+    bufWrite(&dump_buf, stdout);
+}
+
+int cmpInt(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+
+
+
+/*
+    메인 함수에 반복적으로 필요한 기능을 모듈화한 함수들
+*/
+int usePage(int i, char type, char pid) {
+    /*
+        free 상태인 i 번 page 를 type 으로 할당하고 i 를 반환한다.
+    */
+    if (i >= pf_hwm) pf_hwm = i + 1;
+    pf_type[i] = type;
+    pf_used[i] = TRUE;
+    pf_pid[i] = pid;
+    pf_ref[i] = FALSE;
+    pf_last_ref[i] = ws_sample;
+    nr_free--;
+    if (pcb_table[(unsigned char)pid]) pcb_table[(unsigned char)pid]->rss++;
+    markPage(i);
+    TRACE_EV(EV_PAGE_ALLOC, pid, 0, type, i, 0, NULL);
+    return i;
+}
+
+int getFreePage(char type, char pid) {
+    /*
+        : pf_used 를 순회하면서, Free Page 가 있으면 해당 page 의 pfn 을 반환하고
+        없으면 0 을 반환하는 함수
+        
+        type: 반환될 page가 사용될 타입 (PageDir/PageMidDir/PageTable/PageFrame)
+        pid: 반환될 page 를 사용할 process 의 id (해당 process 의 rss 에 더해진다)
+
+        pf_used 순회하면서
+            - free page 가 있으면
+                - pf_type[i] = type
+                - pf_used[i] = TRUE
+                - return i
+            - free page 가 없으면 
+                - return 0
+    */
+    int i = findByte(pf_used, 1, pfl_sz, FALSE);
+    if (i == pfl_sz) return 0;
+    return usePage(i, type, pid);
+}
+
+int nearPage(Page* pgtable, int pti) {
+    /*
+        pgtable 의 pti 번 엔트리에 매핑하면 나중에 PageTable 을 superpage 로 올릴 수 있는 free page 를 고른다. 없으면 0 반환.
+            - 다른 엔트리가 매핑되어 있으면, 그 PageFrame 들과 pfn 이 엔트리 순서대로 이어지는 page
+            - 매핑된 엔트리가 없으면, 4 개가 모두 free 인 (pfn 이 4 의 배수에서 시작하는) 구간 중 가장 뒤의 구간에서 pti 번째 page
+              (다른 page 는 앞에서부터 할당되므로, 나머지 엔트리가 채워질 때까지 구간이 비어있을 가능성이 크다)
+    */
+    int limit = pfl_sz < PFN_LIMIT ? pfl_sz : PFN_LIMIT;  // PTE 에 담을 수 없는 pfn 은 고르지 않는다
+    int empty = TRUE;
+    for (int j = 0; j < 4; ++j) {
+        char ent = pgtable->pte[j];
+        if (j == pti || !(ent & PRESENT_BIT_MASK)) continue;
+        int pfn = ((ent & PFN_MASK) >> PFN_SHIFT) + pti - j;
+        if (pfn > 0 && pfn < limit && !pf_used[pfn]) return pfn;
+        empty = FALSE;
+    }
+    if (!empty) return 0;
+    for (int b = (limit - 4) & ~3; b >= 4; b -= 4)
+        if (!pf_used[b] && !pf_used[b + 1] && !pf_used[b + 2] && !pf_used[b + 3]) return b + pti;
+    return 0;
+}
+
+int getPageFrame() {
+    /*
+        PageFrame 큐의 head 의 pfn 을 반환하는 함수 (비어있으면 0)
+    */
+    return pf_next[0];
+}
+
+int getOldestPageFrame(char pid) {
+    /*
+        PageFrame 큐에서 pid 의 가장 오래된 PageFrame 의 pfn 을 반환. 없으면 0 반환
+    */
+    for (int curr = pf_next[0]; curr != 0; curr = pf_next[curr]) {
+        if (pf_pid[curr] == pid) return curr;
+    }
+    return 0;
+}
+
+int getVictimPageFrame() {
+    /*
+        swap out 할 PageFrame 을 고른다.
+        rss 가 soft limit 을 넘은 process 의 가장 오래된 PageFrame 을 먼저 고르고,
+        그런 process 가 없으면 기존처럼 PageFrame 큐의 head 를 반환한다.
+    */
+    for (int curr = pf_next[0]; curr != 0; curr = pf_next[curr]) {
+        PCB* pcb = pcb_table[(unsigned char)pf_pid[curr]];
+        if (pcb && pcb->rss_soft && pcb->rss > pcb->rss_soft) return curr;
+    }
+    return getPageFrame();
+}
+
+int getFreeSwapPage() {
+    /*
+        스왑 영역의 남는 페이지의 spn 을 반환 (없으면 0)
+    */
+    int i = findByte(sp_used, 1, spl_sz, FALSE);
+    return i < spl_sz ? i : 0;
+}
+
+int getFreeSwapCluster(int n, int* len) {
+    /*
+        연속된 free 스왑 페이지 n 개의 시작 spn 을 반환한다.
+        n 개가 연속된 자리가 없으면 가장 긴 연속 구간의 시작 spn 을 반환하고, 구간 길이는 len 에 저장한다.
+        free 스왑 페이지가 하나도 없으면 0 반환.
+    */
+    int best = 0, best_len = 0;
+    for (int i = findByte(sp_used, 1, spl_sz, FALSE); i < spl_sz; ) {
+        int j = findOtherByte(sp_used, i, i + n < spl_sz ? i + n : spl_sz, FALSE);
+        if (j - i > best_len) {
+            best = i;
+            best_len = j - i;
+        }
+        if (best_len == n) break;
+        i = findByte(sp_used, j, spl_sz, FALSE);
+    }
+    *len = best_len;
+    return best;
+}
+
+int findSwapPage(char pid, unsigned char add) {
+    /*
+        (pid, address) 쌍에 부합하는 사용 중인 스왑페이지의 spn 을 반환. 없으면 0 반환
+    */
+    for (int i = findByte(sp_pid, 1, spl_sz, pid); i < spl_sz; i = findByte(sp_pid, i + 1, spl_sz, pid)) {
+        if (sp_used[i] && sp_fadd[i] <= add && add <= sp_fadd[i] + 3) return i;
+    }
+    return 0;
+}
+
+SPI* getSwapPage(char pid, unsigned char add) {
+    /*
+        (pid, address) 쌍에 부합하는 스왑페이지가 있으면 반환. 없으면 NULL 반환
+    */
+    SPI* spi = createSPI();
+    int i = findSwapPage(pid, add);
+    if (!i) return NULL;
+    sp_used[i] = FALSE;
+    if (pcb_table[(unsigned char)pid]) pcb_table[(unsigned char)pid]->nswap--;
+    markSwap(i);
+    TRACE_EV(EV_SWAP_USE, pid, 0, FALSE, i, 0, NULL);
+    copySPI(i, spi);
+    return spi;
+}
+
+void putBackSwapPage(PCB* pcb, SPI* spi) {
+    /*
+        getSwapPage 로 꺼낸 스왑 페이지를 가져올 자리가 없을 때, 스왑 공간에 그대로 남겨둔다.
+    */
+    sp_used[spi->spn] = TRUE;
+    pcb->nswap++;
+    markSwap(spi->spn);
+    TRACE_EV(EV_SWAP_USE, pcb->pid, 0, TRUE, spi->spn, 0, NULL);
+}
+
+void swapIn(SPI* spi, int pfn) {
+    /*
+        스왑 페이지의 내용을 pfn 번 page 에 저장한다.
+        해당 페이지와 관련된 PageFrame 과 PageTable 의 정보도 갱신한다.
+    */
+    // page 내용 복사
+    Page* page = getPage(pfn);
+    Page* pgtable = getPage(spi->pgtable);
+    copyPage(&spi->page, page);
+    markPage(pfn);
+    TRACE_EV(EV_PAGE_DATA, spi->pid, 1, 0, pfn, 0, page);
+    // PF 업데이트
+    addPGF(pfn, spi->pgtable, spi->ptenti, spi->fadd);
+    pf_last_ref[pfn] = spi->last_ref;
+    // PT 업데이트 (PT_HASHED 면 hashed inverted page table 에 건다)
+    if (pt_mode == PT_HASHED) iptInsert(pfn);
+    else {
+        pgtable->pte[(int)spi->ptenti] = (pfn << 2) + PRESENT_BIT_MASK;
+        markPage(spi->pgtable);
+        TRACE_EV(EV_PTE, spi->pid, spi->ptenti, pgtable->pte[(int)spi->ptenti], spi->pgtable, 0, NULL);
+    }
+    nr_swapin++;
+}
+
+void swapOut(int pfn, int spn) {    
+    /*
+        pfn 번 PageFrame 정보를 spn 번 스왑 페이지에 저장.
+        관련된 PageTable 을 갱신한다.
+    */
+    Page* page = getPage(pfn);
+    // swap 공간에 복사
+    copyPage(page, getSwapSpace(spn));
+    sp_pgtable[spn] = pf_pgtable[pfn];
+    sp_ptenti[spn] = pf_ptenti[pfn];
+    sp_pid[spn] = pf_pid[pfn];
+    sp_fadd[spn] = pf_fadd[pfn];
+    sp_used[spn] = TRUE;
+    if (spn >= sp_hwm) sp_hwm = spn + 1;
+    // 아직 샘플되지 않은 reference bit 는 다음 샘플 번호로 옮겨 둔다
+    sp_last_ref[spn] = pf_ref[pfn] ? ws_sample + 1 : pf_last_ref[pfn];
+    if (pcb_table[(unsigned char)pf_pid[pfn]]) pcb_table[(unsigned char)pf_pid[pfn]]->nswap++;
+    markSwap(spn);
+    TRACE_EV(EV_SWAP_SET, pf_pid[pfn], pf_ptenti[pfn], pf_fadd[pfn], spn, pf_pgtable[pfn], page);
+    // page 초기화
+    setZeroPage(page);
+    markPage(pfn);
+    if (pt_mode == PT_HASHED) iptRemove(pfn);
+    else {
+        getPage(pf_pgtable[pfn])->pte[(int)pf_ptenti[pfn]] = (spn << SPN_SHIFT);
+        markPage(pf_pgtable[pfn]);
+        TRACE_EV(EV_PTE, pf_pid[pfn], pf_ptenti[pfn], spn << SPN_SHIFT, pf_pgtable[pfn], 0, NULL);
+    }
+    nr_swapout++;
+}
+
+void updateReadahead(PCB* pcb, int vpn) {
+    /*
+        swap in 이 일어난 vpn 을 보고 직전 readahead 가 쓸모 있었는지 판단해서 window 를 조절한다.
+            - 직전에 가져온 범위 바로 옆에서 fault 가 나면 (순차 접근) -> 가져온 페이지들을 사용한 것으로 보고 window 를 늘린다
+            - 다른 곳에서 fault 가 나면 -> 가져온 페이지들이 쓰이지 않은 것으로 보고 window 를 절반으로 줄인다 (최소 1)
+    */
+    if (pcb->ra_hi < 0) return;
+    if (vpn == pcb->ra_hi + 1 || vpn == pcb->ra_lo - 1) {
+        if (pcb->ra_win < ra_max) pcb->ra_win++;
+    }
+    else if (pcb->ra_win > 1) pcb->ra_win /= 2;
+    if (pcb->ra_win > ra_max) pcb->ra_win = ra_max;
+}
+
+int swapInAround(PCB* pcb, Page* pgtable, unsigned char va) {
+    /*
+        va 페이지와 같은 PageTable 에 있는 스왑된 이웃 페이지들을 pcb->ra_win 개까지 함께 swap in 한다.
+        (pgtable 이 NULL 이면 PT_HASHED 라서, 이웃이 스왑되어 있는지 스왑 페이지 정보에서 찾는다)
+        readahead 를 위해 다른 페이지를 swap out 하지는 않기 때문에, free page 가 남아있는 만큼만 가져온다.
+        앞쪽(va 가 커지는 방향) 이웃을 먼저 가져오고, 가져온 페이지 수를 반환한다.
+    */
+    int pti = (va & PT_MASK) >> PT_SHIFT;
+    int vpn = va >> PT_SHIFT;
+    int n = 0;
+    pcb->ra_lo = pcb->ra_hi = -1;
+    for (int d = 1; d <= RA_MAX_WINDOW && n < pcb->ra_win; ++d) {
+        int near[2] = { pti + d, pti - d };
+        for (int k = 0; k < 2 && n < pcb->ra_win; ++k) {
+            int j = near[k];
+            if (j < 0 || j > 3) continue;
+            unsigned char add = (va & ~(PT_MASK | PO_MASK)) | (j << PT_SHIFT);
+            if (pgtable == NULL) {
+                if (!findSwapPage(pcb->pid, add)) continue;
+            }
+            else if ((pgtable->pte[j] & PRESENT_BIT_MASK) || !(pgtable->pte[j] & SPN_MASK)) continue;
+            if (pcb->rss_max && pcb->rss >= pcb->rss_max) return n;
+            int pfn = superpage && pgtable ? nearPage(pgtable, j) : 0;
+            pfn = pfn ? usePage(pfn, PF_TYPE, pcb->pid) : getFreePage(PF_TYPE, pcb->pid);
+            if (!pfn) return n;
+            SPI* spi = getSwapPage(pcb->pid, add);
+            swapIn(spi, pfn);
+            n++;
+            if (pcb->ra_lo < 0) pcb->ra_lo = pcb->ra_hi = vpn;
+            if (vpn + j - pti < pcb->ra_lo) pcb->ra_lo = vpn + j - pti;
+            if (vpn + j - pti > pcb->ra_hi) pcb->ra_hi = vpn + j - pti;
+        }
+    }
+    return n;
+}
+
+
+
+
+/*
+    ku_mmc.h 의 핵심 함수들
+*/
+int demoteSuperpage(int victim) {
+    /*
+        superpage 에 속한 victim 을 swap out 할 수 있도록 superpage 를 다시 PageTable 로 되돌린다.
+        reclaim 중에는 PageTable 로 쓸 free page 가 없으므로, victim 을 먼저 스왑 페이지로 내보내고 그 page 를 PageTable 로 쓴다.
+        되돌린 뒤에 실제로 PageFrame 을 free 하려면 스왑 페이지가 하나 더 필요하므로, 스왑 페이지가 2 개 이상 남아있을 때만 되돌린다.
+        새 PageTable 의 pfn 을 반환한다. (스왑 공간이 모자라면 아무것도 바꾸지 않고 0)
+    */
+    int pmd = pf_pgtable[victim], pmdi = pf_ptenti[victim];
+    int pti = (pf_fadd[victim] & PT_MASK) >> PT_SHIFT;
+    Page* pmdpage = getPage(pmd);
+    Page* pgtable = getPage(victim);
+    int base = (pmdpage->pte[pmdi] & PFN_MASK) >> PFN_SHIFT;
+    int spn = getFreeSwapPage();
+    if (!spn || findByte(sp_used, spn + 1, spl_sz, FALSE) == spl_sz) return 0;
+    // victim 의 내용을 내보내면 victim 자리의 pti 번 엔트리에 spn 이 남는다
+    removePGF(victim);
+    TRACE_EV(EV_PAGE_FREE, pf_pid[victim], 0, 0, victim, 0, NULL);
+    pf_type[victim] = PT_TYPE;
+    TRACE_EV(EV_PAGE_ALLOC, pf_pid[victim], 0, PT_TYPE, victim, 0, NULL);
+    pf_pgtable[victim] = victim;
+    pf_ptenti[victim] = pti;
+    swapOut(victim, spn);
+    // 나머지 PageFrame 들은 새 PageTable 의 엔트리로 옮긴다
+    for (int j = 0; j < 4; ++j) {
+        if (j == pti) continue;
+        pgtable->pte[j] = ((base + j) << PFN_SHIFT) + PRESENT_BIT_MASK;
+        TRACE_EV(EV_PTE, pf_pid[victim], j, pgtable->pte[j], victim, 0, NULL);
+        setPGF(base + j, victim, j);
+    }
+    pmdpage->pte[pmdi] = (victim << PFN_SHIFT) + PRESENT_BIT_MASK;
+    markPage(pmd);
+    TRACE_EV(EV_PTE, pf_pid[victim], pmdi, pmdpage->pte[pmdi], pmd, 0, NULL);
+    nr_demote++;
+    return victim;
+}
+
+int swapOutCluster(int victim) {
+    /*
+        victim 페이지를 swap out 하면서, 같은 PageTable 에 있는 (VA 가 인접한) 페이지들을
+        swap_cluster 개까지 묶어서 연속된 스왑 페이지에 VA 순서대로 내보낸다.
+        내보낸 PageFrame 들은 free 상태가 되고, 내보낸 페이지 수를 반환한다. (내보낼 수 없으면 0)
+        victim 이 superpage 에 속하면 먼저 PageTable 로 되돌리고, 같은 PageTable 에 남은 가장 오래된 PageFrame 을 victim 으로 한다.
+    */
+    int batch[SWAP_CLUSTER_MAX];
+    int n = 0, len;
+    if (victim == 0) return 0;
+    TRACE_EV(EV_RECLAIM_BEGIN, pf_pid[victim], 0, 0, victim, 0, NULL);
+    if (pf_type[pf_pgtable[victim]] == PMD_TYPE) {
+        int pt = demoteSuperpage(victim);
+        if (!pt) {
+            TRACE_EV(EV_RECLAIM_END, pf_pid[victim], 0, 0, 0, 0, NULL);
+            return 0;
+        }
+        for (victim = pf_next[0]; pf_pgtable[victim] != pt; victim = pf_next[victim]);
+    }
+    // victim 과 같은 PageTable 의 페이지 (같은 pid, 같은 PD/PMD index) 를 오래된 순서대로 모은다
+    for (int curr = victim; curr != 0 && n < swap_cluster; curr = pf_next[curr]) {
+        if (pf_pid[curr] == pf_pid[victim] && (pf_fadd[curr] >> PMD_SHIFT) == (pf_fadd[victim] >> PMD_SHIFT)) batch[n++] = curr;
+    }
+    int spn = getFreeSwapCluster(n, &len);
+    if (!spn) {
+        TRACE_EV(EV_RECLAIM_END, pf_pid[victim], 0, 0, 0, 0, NULL);
+        return 0;
+    }
+    if (len < n) n = len;
+    // 스왑 공간에서도 VA 순서가 되도록 PT entry index 순으로 정렬
+    for (int i = 1; i < n; ++i) {
+        int key = batch[i];
+        int j = i - 1;
+        while (j >= 0 && pf_ptenti[batch[j]] > pf_ptenti[key]) {
+            batch[j + 1] = batch[j];
+            j--;
+        }
+        batch[j + 1] = key;
+    }
+    for (int i = 0; i < n; ++i) {
+        int pfn = batch[i];
+        PCB* pcb = pcb_table[(unsigned char)pf_pid[pfn]];
+        if (pcb) pcb->rss--;
+        removePGF(pfn);
+        swapOut(pfn, spn + i);
+        pf_type[pfn] = P_TYPE_UNDEFINED;
+        pf_used[pfn] = FALSE;
+        nr_free++;
+        TRACE_EV(EV_PAGE_FREE, pf_pid[pfn], 0, 0, pfn, 0, NULL);
+    }
+    TRACE_EV(EV_RECLAIM_END, pf_pid[victim], 0, 0, n, 0, NULL);
+    return n;
+}
+
+void destroyProc(PCB* pcb) {
+    /*
+        process 의 주소 공간을 한 번에 정리한다.
+        PageFrame, PageDir/PageMidDir/PageTable 을 포함한 모든 page 와 스왑 페이지를 free 하고 PCB 를 지운다.
+    */
+    char pid = pcb->pid;
+    for (int i = findByte(pf_pid, 1, pfl_sz, pid); i < pfl_sz; i = findByte(pf_pid, i + 1, pfl_sz, pid)) {
+        if (!pf_used[i]) continue;
+        if (pf_type[i] == PF_TYPE) {
+            removePGF(i);
+            if (pt_mode == PT_HASHED) iptRemove(i);
+        }
+        setZeroPage(getPage(i));
+        pf_type[i] = P_TYPE_UNDEFINED;
+        pf_used[i] = FALSE;
+        nr_free++;
+        markPage(i);
+        TRACE_EV(EV_PAGE_FREE, pid, 0, 0, i, 0, NULL);
+    }
+    for (int i = findByte(sp_pid, 1, spl_sz, pid); i < spl_sz; i = findByte(sp_pid, i + 1, spl_sz, pid)) {
+        if (!sp_used[i]) continue;
+        sp_used[i] = FALSE;
+        sp_pgtable[i] = 0;
+        markSwap(i);
+        TRACE_EV(EV_SWAP_FREE, pid, 0, 0, i, 0, NULL);
+    }
+    pwcFlush(pcb);
+    removePCB(pcb_list, pcb);
+    TRACE_EV(EV_PROC_EXIT, pid, 0, 0, 0, 0, NULL);
+}
+
+int oomKill(char pid) {
+    /*
+        free page 도 스왑 공간도 없을 때, 사용 중인 PageFrame 과 스왑 페이지가 가장 많은 process 를 골라 정리한다.
+        page fault 를 처리 중인 pid 는 고르지 않는다. 정리할 process 가 없으면 0, 있으면 1 반환.
+        PageFrame 을 가진 (rss 가 0 보다 큰) process 를 먼저 고르고, 없으면 스왑 페이지만 가진 process 를 정리해서
+        호출한 쪽이 다시 swap out 할 수 있게 한다.
+    */
+    PCB* victim = NULL;
+    for (PCB* pcb = pcb_list->head; pcb != NULL; pcb = pcb->next) {
+        if (pcb->pid == pid || pcb->rss + pcb->nswap == 0) continue;
+        if (victim == NULL || (pcb->rss > 0) > (victim->rss > 0)
+            || ((pcb->rss > 0) == (victim->rss > 0) && pcb->rss + pcb->nswap > victim->rss + victim->nswap)) victim = pcb;
+    }
+    if (victim == NULL) return 0;
+    oom_kills++;
+    oom_last_victim = victim->pid;
+    destroyProc(victim);
+    return 1;
+}
+
+int addPage(char type, char pid) {
+    /*
+        free page 나, 스왑 가능한 page 를 알아서 처리후 사용 가능한 page 의 pfn 반환.
+        사용 가능한 page 가 없을 경우 0 반환. 
+        (page[0] 은 NULL 값으로 초기화되어 있고, 그 후에 변경되지 않기 때문에, 나중에 fail 처리가 가능)
+        pid 의 rss 가 hard limit 에 닿아 있으면, 다른 process 가 아닌 자신의 페이지를 내보내서 자리를 만든다.
+        어떻게 page 를 얻었는지 add_cnt 에 센다.
+    */
+    int pfn, how = ADD_FREE;
+    PCB* pcb = pcb_table[(unsigned char)pid];
+    if (pcb && pcb->rss_max && pcb->rss >= pcb->rss_max) {
+        if (swapOutCluster(getOldestPageFrame(pid)) == 0) {
+            add_cnt[ADD_FAIL]++;
+            return 0;  // fail
+        }
+        how = ADD_RECLAIM;
+    }
+    pfn = getFreePage(type, pid);
+    // free page 가 없으면 swap out 으로 자리를 만든 뒤 다시 시도
+    while (!pfn) {
+        // PageFrame 이나 SwapSpace 중 하나라도 없으면 다른 process 를 OOM 으로 정리하고, 그것도 안 되면 fail
+        // (OOM 으로 스왑 페이지만 돌아왔으면 다음 반복에서 swap out 으로 자리를 만든다)
+        if (swapOutCluster(getVictimPageFrame()) > 0) {
+            if (how != ADD_OOM) how = ADD_RECLAIM;
+        }
+        else if (oomKill(pid)) how = ADD_OOM;
+        else {
+            add_cnt[ADD_FAIL]++;
+            return 0;  // fail
+        }
+        pfn = getFreePage(type, pid);
+    }
+    add_cnt[pfn ? how : ADD_FAIL]++;
+    setZeroPage(getPage(pfn));
+    return pfn;
+}
+
+int addFrame(PCB* pcb, Page* pgtable, int pti) {
+    /*
+        pgtable 의 pti 번 엔트리에 매핑할 PageFrame 을 얻는다.
+        superpage 가 켜져 있으면 같은 PageTable 의 PageFrame 들과 pfn 이 이어지는 free page 를 먼저 쓰고, 없으면 addPage 와 같다.
+    */
+    int pfn = superpage ? nearPage(pgtable, pti) : 0;
+    if (!pfn || (pcb->rss_max && pcb->rss >= pcb->rss_max)) return addPage(PF_TYPE, pcb->pid);
+    usePage(pfn, PF_TYPE, pcb->pid);
+    add_cnt[ADD_FREE]++;
+    setZeroPage(getPage(pfn));
+    return pfn;
+}
+
+void recordWalk(int refs) {
+    walk_cnt[refs < WALK_REFS_MAX ? refs : WALK_REFS_MAX]++;
+    walk_refs += refs;
+}
+
+void promotePT(PCB* pcb, unsigned char va, Page* pgtable) {
+    /*
+        va 의 PageTable 이 꽉 차 있고 엔트리들이 가리키는 PageFrame 4 개의 pfn 이 엔트리 순서대로 이어져 있으면,
+        PageMidDir 엔트리가 그 PageFrame 들을 superpage 로 바로 가리키게 하고 PageTable 은 free 한다.
+        PageFrame 들은 PageMidDir 엔트리를 가리키게 되고, PageTable 안에서의 위치는 pf_fadd 로 안다.
+    */
+    int base = (pgtable->pte[0] & PFN_MASK) >> PFN_SHIFT;
+    for (int j = 0; j < 4; ++j)
+        if (!(pgtable->pte[j] & PRESENT_BIT_MASK) || ((pgtable->pte[j] & PFN_MASK) >> PFN_SHIFT) != base + j) return;
+    int pmdi = (va & PMD_MASK) >> PMD_SHIFT;
+    int pmd = (pcb->pgdir->pte[(va & PD_MASK) >> PD_SHIFT] & PFN_MASK) >> PFN_SHIFT;
+    int pt = pgtable - pmem_base;
+    Page* pmdpage = getPage(pmd);
+    pmdpage->pte[pmdi] = (base << PFN_SHIFT) + PS_BIT_MASK + PRESENT_BIT_MASK;
+    markPage(pmd);
+    TRACE_EV(EV_PTE, pcb->pid, pmdi, pmdpage->pte[pmdi], pmd, 0, NULL);
+    for (int j = 0; j < 4; ++j) setPGF(base + j, pmd, pmdi);
+    // PageTable free
+    setZeroPage(pgtable);
+    pf_type[pt] = P_TYPE_UNDEFINED;
+    pf_used[pt] = FALSE;
+    nr_free++;
+    pcb->rss--;
+    markPage(pt);
+    TRACE_EV(EV_PAGE_FREE, pcb->pid, 0, 0, pt, 0, NULL);
+    pwcInvalidate(pcb, va);
+    nr_promote++;
+}
+
+int handleHashedFault(PCB* pcb, unsigned char va, int* kind) {
+    /*
+        PT_HASHED 일 때의 page fault 처리
+        : hashed inverted page table 에서 (pid, vpn) 을 찾고, 없으면 스왑 공간에서 가져오거나 새 PageFrame 을 할당한다.
+          PageDir/PageMidDir/PageTable 이 없으므로 결과는 FAULT_MAPPED/FAULT_FIRST/FAULT_SWAPIN 중 하나다.
+    */
+    int refs, pfn = iptLookup(pcb->pid, va, &refs);
+    recordWalk(refs);
+    *kind = FAULT_MAPPED;
+    if (!pfn) {
+        SPI* spi = getSwapPage(pcb->pid, va);
+        pfn = addPage(PF_TYPE, pcb->pid);
+        if (spi) {
+            if (!pfn) {
+                putBackSwapPage(pcb, spi);
+                return -1;
+            }
+            swapIn(spi, pfn);
+            *kind = FAULT_SWAPIN;
+            if (ra_max) {
+                updateReadahead(pcb, va >> PT_SHIFT);
+                swapInAround(pcb, NULL, va);
+            }
+        }
+        else {
+            if (!pfn) return -1;
+            addPGF(pfn, 0, (va & PT_MASK) >> PT_SHIFT, va);
+            iptInsert(pfn);
+            *kind = FAULT_FIRST;
+        }
+    }
+    pf_ref[pfn] = TRUE;
+    return 0;
+}
+
+int handlePageFault(char pid, unsigned char va, int* kind) {
+    /*
+        pid: page fault 가 발생한 프로세스의 id
+        va: page fault 가 발생한 Virtual Address
+        kind: 처리 결과 (FAULT_MAPPED/FAULT_FIRST/FAULT_TABLE/FAULT_SWAPIN, fail 은 호출한 쪽에서 센다)
+
+        전제조건
+            - pid 의 process 가 돌아가고 있고
+            - va 접근이 page fault 가 난 상태
+
+        - 접근하려는 주소: 11 00 10 11
+        - PageDir index: 11
+        - PageMidDir index: 00
         - PageTable index: 10
         - Offset: 11
+
+        paging-structure cache 가 켜져 있으면 hit 한 단계부터 걷고, 읽어야 하는 엔트리 수를 walk_cnt 에 센다.
+        PageMidDir 엔트리가 superpage 면 PageTable 단계 없이 끝나고,
+        superpage 가 켜져 있으면 PageFrame 을 매핑한 뒤 PageTable 을 superpage 로 올릴 수 있는지 본다.
     */
     
-    int ent, p, pfn, spn;
-    PCB* pcb = searchPCB(pcb_list, pid);
+    int ent, p, pfn = 0, spn, from, ps = 0, ret = 0;
+    PCB* pcb = searchPCB(pid);
     Page* lpage;
+    Page* pgtable = NULL;
     char enti[4];
     char mask[4] = { PD_MASK, PMD_MASK, PT_MASK, PO_MASK };
     char shift[4] = { PD_SHIFT, PMD_SHIFT, PT_SHIFT, PO_SHIFT };
@@ -580,41 +1855,341 @@ int ku_page_fault (char pid, unsigned char va) {
         enti[i] = ((unsigned char)va & mask[i]) >> shift[i];
     }
 
-    lpage = pcb->pgdir;
-    for (int i = 0; i < 3; ++i) {
-        ent = lpage->pte[(int)enti[i]];
-        // PageMidDir PFN 구하기
-        p = ent & PRESENT_BIT_MASK;
-        pfn = (ent & PFN_MASK) >> PFN_SHIFT;
-        spn = (ent & SPN_MASK) >> SPN_SHIFT;
-        if (p) {
-            /* 매핑 된 상태 */
-            lpage = pg_free_list[pfn].page;
-        }
-        else if (spn) {
-            /* 스왑된 상태 */
-            if (i != 2) return -1;
-            // 스왑 페이지 가져오기
-            SPI* spi = getSwapPage(pcb->pid, (unsigned char)va);
-            pfn = addPage(type[i]);
-            swapIn(spi, pfn);
-        }
-        else {
-            /* 접근한 적 없는 상태 (lpage 의 해당 엔트리가 비어있는 상태) */
-            pfn = addPage(type[i]);
-            Page* npage = pg_free_list[pfn].page;
-            // 새로 만들 수 없는 경우 fail
-            if (npage == NULL) return -1;
-            // 이전 페이지의 엔트리 업데이트
-            lpage->pte[(int)enti[i]] = (pfn << 2) + PRESENT_BIT_MASK;
-            if (i == 2) {  // PageTable 에 PageFrame 을 추가할 때 -> pgf_queue 업데이트
-                addPGF(pgf_queue, npage, lpage, pfn, enti[i], pcb->pid, (unsigned char)va);
-            }
-            lpage = npage;
+    *kind = FAULT_MAPPED;
+    lpage = pcb->pgdir;
+    if (pt_mode == PT_HASHED) return handleHashedFault(pcb, va, kind);
+    from = pwc_on ? pwcLookup(pcb, va, &lpage) : 0;
+    for (int i = from; i < 3; ++i) {
+        ent = lpage->pte[(int)enti[i]];
+        // PageMidDir PFN 구하기
+        p = ent & PRESENT_BIT_MASK;
+        pfn = (ent & PFN_MASK) >> PFN_SHIFT;
+        spn = (ent & SPN_MASK) >> SPN_SHIFT;
+        if (i == 2) pgtable = lpage;
+        if (p && i == 1 && (ent & PS_BIT_MASK)) {
+            /* superpage 로 매핑 된 상태 */
+            pfn += enti[2];
+            ps = 1;
+            break;
+        }
+        else if (p) {
+            /* 매핑 된 상태 */
+            lpage = getPage(pfn);
+            if (pwc_on && i < 2) pwcFill(pcb, i, va, pfn);
+        }
+        else if (spn) {
+            /* 스왑된 상태 */
+            if (i != 2) {
+                ret = -1;
+                break;
+            }
+            // 스왑 페이지 가져오기
+            SPI* spi = getSwapPage(pcb->pid, (unsigned char)va);
+            pfn = addFrame(pcb, lpage, enti[i]);
+            if (!pfn) {
+                // 가져올 자리가 없으면 스왑 페이지를 그대로 두고 fail
+                putBackSwapPage(pcb, spi);
+                ret = -1;
+                break;
+            }
+            swapIn(spi, pfn);
+            *kind = FAULT_SWAPIN;
+            // 이웃 페이지 readahead
+            if (ra_max) {
+                updateReadahead(pcb, (unsigned char)va >> PT_SHIFT);
+                swapInAround(pcb, lpage, (unsigned char)va);
+            }
+        }
+        else {
+            /* 접근한 적 없는 상태 (lpage 의 해당 엔트리가 비어있는 상태) */
+            pfn = i == 2 ? addFrame(pcb, lpage, enti[i]) : addPage(type[i], pcb->pid);
+            Page* npage = getPage(pfn);
+            // 새로 만들 수 없는 경우 fail
+            if (npage == NULL) {
+                ret = -1;
+                break;
+            }
+            // 이전 페이지의 엔트리 업데이트
+            lpage->pte[(int)enti[i]] = (pfn << 2) + PRESENT_BIT_MASK;
+            markPage(lpage - pmem_base);
+            TRACE_EV(EV_PTE, pid, enti[i], lpage->pte[(int)enti[i]], lpage - pmem_base, 0, NULL);
+            if (i == 2) {  // PageTable 에 PageFrame 을 추가할 때 -> PageFrame 큐 업데이트
+                addPGF(pfn, lpage - pmem_base, enti[i], (unsigned char)va);
+                if (*kind != FAULT_TABLE) *kind = FAULT_FIRST;
+            }
+            else {
+                *kind = FAULT_TABLE;
+                if (pwc_on) pwcFill(pcb, i, va, pfn);
+            }
+            lpage = npage;
+        }
+    }
+    recordWalk(WALK_REFS_MAX - from - ps);
+    if (ret < 0) return -1;
+    pf_ref[pfn] = TRUE;
+    if (superpage && *kind != FAULT_MAPPED) promotePT(pcb, va, pgtable);
+
+    return 0;
+}
+
+int walkPage(PCB* pcb, unsigned char va) {
+    /*
+        pcb 의 페이지 테이블을 따라가서 va 가 매핑된 PageFrame 의 pfn 을 반환한다.
+        중간에 present 하지 않은 엔트리가 있으면 0 반환. (PT_HASHED 면 hashed inverted page table 에서 찾는다)
+        PageMidDir 엔트리가 superpage 면 그 엔트리의 pfn 에 PageTable index 를 더한 PageFrame 이다.
+    */
+    if (pt_mode == PT_HASHED) return iptLookup(pcb->pid, va, NULL);
+    char enti[3] = { (va & PD_MASK) >> PD_SHIFT, (va & PMD_MASK) >> PMD_SHIFT, (va & PT_MASK) >> PT_SHIFT };
+    Page* lpage = pcb->pgdir;
+    int pfn = 0;
+    for (int i = 0; i < 3; ++i) {
+        char ent = lpage->pte[(int)enti[i]];
+        if (!(ent & PRESENT_BIT_MASK)) return 0;
+        pfn = (ent & PFN_MASK) >> PFN_SHIFT;
+        if (i == 1 && (ent & PS_BIT_MASK)) return pfn + enti[2];
+        lpage = getPage(pfn);
+    }
+    return pfn;
+}
+
+void suspendProc(PCB* pcb) {
+    /*
+        pcb 의 PageFrame 들을 모두 swap out 하고 suspend 상태로 만든다.
+        (PageDir/PageMidDir/PageTable 은 swap 되지 않으므로 그대로 남는다)
+    */
+    pcb->suspended = TRUE;
+    pcb->lc_since = ws_sample;
+    while (swapOutCluster(getOldestPageFrame(pcb->pid)) > 0);
+}
+
+void resumeProc(PCB* pcb) {
+    pcb->suspended = FALSE;
+    pcb->lc_since = ws_sample;
+}
+
+PCB* getSuspendCandidate() {
+    /*
+        active process 중 우선순위가 가장 낮은 process 를 반환 (같으면 가장 오래 실행된 process)
+    */
+    PCB* ret = NULL;
+    for (PCB* pcb = pcb_list->head; pcb != NULL; pcb = pcb->next) {
+        if (pcb->suspended) continue;
+        if (ret == NULL || pcb->prio < ret->prio
+            || (pcb->prio == ret->prio && pcb->lc_since < ret->lc_since)) ret = pcb;
+    }
+    return ret;
+}
+
+PCB* getResumeCandidate() {
+    /*
+        suspend 된 process 중 우선순위가 가장 높은 process 를 반환 (같으면 가장 오래 기다린 process)
+    */
+    PCB* ret = NULL;
+    for (PCB* pcb = pcb_list->head; pcb != NULL; pcb = pcb->next) {
+        if (!pcb->suspended) continue;
+        if (ret == NULL || pcb->prio > ret->prio
+            || (pcb->prio == ret->prio && pcb->lc_since < ret->lc_since)) ret = pcb;
+    }
+    return ret;
+}
+
+void loadControl() {
+    /*
+        active process 들의 working set 합이 물리 메모리보다 크면, 들어갈 때까지 우선순위가 낮은 process 부터 suspend 한다.
+        working set 합에 여유가 생기면 우선순위가 높은 suspend 된 process 부터 다시 깨운다.
+        LC_MAX_WAIT 샘플 이상 기다린 process 는 우선순위가 같거나 낮은 active process 와 자리를 바꿔서 굶지 않게 한다.
+    */
+    int capacity = pfl_sz - 1;
+    int total = 0, nactive = 0;
+    PCB* pcb;
+    for (pcb = pcb_list->head; pcb != NULL; pcb = pcb->next) {
+        if (pcb->suspended) continue;
+        total += pcb->wss;
+        nactive++;
+    }
+    while (total > capacity && nactive > 1) {
+        pcb = getSuspendCandidate();
+        suspendProc(pcb);
+        total -= pcb->wss;
+        nactive--;
+    }
+    while ((pcb = getResumeCandidate()) != NULL) {
+        if (nactive > 0 && total + pcb->wss > capacity) break;
+        resumeProc(pcb);
+        total += pcb->wss;
+        nactive++;
+    }
+    if (pcb != NULL && ws_sample - pcb->lc_since >= LC_MAX_WAIT) {
+        PCB* victim = getSuspendCandidate();
+        if (victim != NULL && victim->prio <= pcb->prio) {
+            suspendProc(victim);
+            resumeProc(pcb);
+        }
+    }
+}
+
+void sampleWorkingSet() {
+    /*
+        모든 PageFrame 의 reference bit 를 읽고 지운 뒤, pid 별 working set 크기를 다시 계산한다.
+        최근 ws_tau 번의 샘플 안에 참조된 페이지(그 사이에 swap out 된 페이지 포함)와,
+        해당 process 의 PageDir/PageMidDir/PageTable 을 working set 으로 본다.
+        suspend 된 process 는 마지막으로 추정한 값을 그대로 유지한다.
+    */
+    int wss[256] = { 0 };
+    ws_sample++;
+    // reference bit 가 켜진 page 만 골라 샘플 번호를 갱신하고, reference bit 는 한 번에 지운다
+    for (int i = findOtherByte(pf_ref, 1, pfl_sz, FALSE); i < pfl_sz; i = findOtherByte(pf_ref, i + 1, pfl_sz, FALSE))
+        pf_last_ref[i] = ws_sample;
+    memset(pf_ref, FALSE, pfl_sz);
+    for (int i = 1; i < pfl_sz; ++i) {
+        if (!pf_used[i]) continue;
+        if (pf_type[i] != PF_TYPE || ws_sample - pf_last_ref[i] < ws_tau)
+            wss[(unsigned char)pf_pid[i]]++;
+    }
+    for (int i = 1; i < spl_sz; ++i) {
+        if (sp_used[i] && ws_sample - sp_last_ref[i] < ws_tau)
+            wss[(unsigned char)sp_pid[i]]++;
+    }
+    for (PCB* pcb = pcb_list->head; pcb != NULL; pcb = pcb->next) {
+        if (!pcb->suspended) pcb->wss = wss[(unsigned char)pcb->pid];
+    }
+    if (load_control) loadControl();
+    if (ws_log) {
+        for (PCB* pcb = pcb_list->head; pcb != NULL; pcb = pcb->next) {
+            fprintf(ws_log, "t=%u pid=%d wss=%d rss=%d%s\n",
+                vtime, pcb->pid, pcb->wss, pcb->rss, pcb->suspended ? " suspended" : "");
+        }
+    }
+}
+
+void tickClock() {
+    vtime++;
+    if (ws_interval && vtime % ws_interval == 0) sampleWorkingSet();
+}
+
+int latBucket(long long ns) {
+    /*
+        ns 가 들어갈 histogram bucket 의 index
+        : 8 보다 작으면 그대로, 아니면 최상위 bit 위치 e 와 그 아래 LAT_SUB_BITS 개 bit 로 정한다.
+    */
+    unsigned long long v = ns < 0 ? 0 : (unsigned long long)ns;
+    if (v < (1 << LAT_SUB_BITS)) return (int)v;
+    int e = 63 - __builtin_clzll(v);
+    return ((e - LAT_SUB_BITS + 1) << LAT_SUB_BITS) + (int)((v >> (e - LAT_SUB_BITS)) & ((1 << LAT_SUB_BITS) - 1));
+}
+
+long long latBucketLow(int b) {
+    /*
+        b 번 bucket 에 들어가는 가장 작은 ns
+    */
+    if (b < (1 << LAT_SUB_BITS)) return b;
+    int e = (b >> LAT_SUB_BITS) + LAT_SUB_BITS - 1;
+    return (long long)(((1ULL << LAT_SUB_BITS) | (b & ((1 << LAT_SUB_BITS) - 1))) << (e - LAT_SUB_BITS));
+}
+
+int readPerf(unsigned long long v[PERF_NR]) {
+    /*
+        열린 counter 들을 한 번의 read 로 읽는다. (counter 가 꺼져 있거나 읽지 못하면 -1 반환)
+    */
+#ifdef __linux__
+    unsigned long long buf[1 + PERF_NR];
+    if (perf_leader < 0 || read(perf_leader, buf, sizeof(buf)) < (ssize_t)(sizeof(buf[0]) * (1 + perf_nr))) return -1;
+    for (int c = 0; c < PERF_NR; ++c) v[c] = perf_fd[c] >= 0 ? buf[1 + perf_pos[c]] : 0;
+    return 0;
+#else
+    (void)v;
+    return -1;
+#endif
+}
+
+void recordPerf(int kind, const unsigned long long* before, const unsigned long long* after) {
+    perf_cnt[kind]++;
+    for (int c = 0; c < PERF_NR; ++c) perf_sum[kind][c] += after[c] - before[c];
+}
+
+void recordFault(char pid, int kind, long long ns) {
+    fault_cnt[kind]++;
+    pid_fault_cnt[(unsigned char)pid][kind]++;
+    lat_hist[kind][latBucket(ns)]++;
+    lat_sum[kind] += ns;
+    if (ns > lat_max[kind]) lat_max[kind] = ns;
+}
+
+void wakeupKswapd() {
+    /*
+        free page 수가 low watermark 아래로 내려갔으면 kswapd 를 깨운다. (mmu_lock 을 잡은 상태에서 호출)
+    */
+    if (kswapd_running && nr_free < wmark_low) pthread_cond_signal(&kswapd_wait);
+}
+
+void* kswapd(void* arg) {
+    /*
+        background reclaim thread
+        : 깨어날 때마다 free page 수가 high watermark 가 될 때까지 swapOutCluster 단위로 swap out 한다.
+          batch 사이마다 lock 을 놓아서, 그 사이에 들어온 page fault 가 먼저 처리될 수 있게 한다.
+    */
+    (void)arg;
+#ifdef KU_MMU_TRACE
+    tl_kswapd = TRUE;
+#endif
+    pthread_mutex_lock(&mmu_lock);
+    while (kswapd_running) {
+        while (kswapd_running && nr_free < wmark_high) {
+            if (swapOutCluster(getVictimPageFrame()) == 0) break;  // 더 내보낼 PageFrame 이나 스왑 공간이 없음
+            pthread_mutex_unlock(&mmu_lock);
+            pthread_mutex_lock(&mmu_lock);
         }
+        TRACE_FLUSH();  // 잠들기 전에 모아 둔 event 를 파일에 붙인다
+        if (kswapd_running) pthread_cond_wait(&kswapd_wait, &mmu_lock);
     }
+    TRACE_FLUSH();
+    pthread_mutex_unlock(&mmu_lock);
+    return NULL;
+}
 
-    return 0;
+int ku_page_fault (char pid, unsigned char va) {
+    int ret, kind = FAULT_FAIL, perf;
+    long long start, ns;
+    unsigned long long pc0[PERF_NR], pc1[PERF_NR];
+    PCB* pcb;
+    pthread_mutex_lock(&mmu_lock);
+    // ku_reference 가 실패해서 들어온 fault 면 그 접근은 이미 셌다
+    if (ref_miss != ((unsigned char)pid << 8 | va)) tickClock();
+    ref_miss = -1;
+    pcb = searchPCB(pid);
+    // load control 로 suspend 된 process 는 다시 깨어날 때까지 fault 를 처리하지 않는다 (PageDir 가 없는 radix process 도 마찬가지)
+    TRACE_EV(EV_FAULT_BEGIN, pid, va, 0, 0, 0, NULL);
+    perf = perf_leader >= 0 && pthread_equal(pthread_self(), perf_thread) && readPerf(pc0) == 0;
+    start = getNs();
+    ret = (pcb == NULL || pcb->suspended || (pcb->pgdir == NULL && pt_mode != PT_HASHED)) ? -1 : handlePageFault(pid, va, &kind);
+    ns = getNs() - start;
+    if (ret < 0) kind = FAULT_FAIL;
+    if (perf && readPerf(pc1) == 0) recordPerf(kind, pc0, pc1);
+    recordFault(pid, kind, ns);
+    TRACE_EV(EV_FAULT_END, pid, va, kind, 0, 0, NULL);
+    wakeupKswapd();
+    pthread_mutex_unlock(&mmu_lock);
+    return ret;
+}
+
+void ku_mmu_destroy();
+int ku_mmu_trace_start(const char* path);
+
+void resetStats() {
+    memset(fault_cnt, 0, sizeof(fault_cnt));
+    memset(pid_fault_cnt, 0, sizeof(pid_fault_cnt));
+    memset(add_cnt, 0, sizeof(add_cnt));
+    memset(lat_hist, 0, sizeof(lat_hist));
+    memset(lat_sum, 0, sizeof(lat_sum));
+    memset(lat_max, 0, sizeof(lat_max));
+    memset(walk_cnt, 0, sizeof(walk_cnt));
+    walk_refs = 0;
+    memset(pwc_hit, 0, sizeof(pwc_hit));
+    memset(pwc_miss, 0, sizeof(pwc_miss));
+    memset(perf_cnt, 0, sizeof(perf_cnt));
+    memset(perf_sum, 0, sizeof(perf_sum));
+    nr_swapin = nr_swapout = 0;
+    nr_promote = nr_demote = 0;
 }
 
 void* ku_mmu_init(unsigned int pmem_size, unsigned int swap_size) {
@@ -622,71 +2197,1004 @@ void* ku_mmu_init(unsigned int pmem_size, unsigned int swap_size) {
         pmem_size: 할당할 physical memory 영역의 크기로, 바이트 단위이다
         swap_size: 할당할 스왑 공간의 크기로, 바이트 단위이다
     */
-    void* pmem = NULL;
-    void* smem = NULL;
     int npage = pmem_size / 4;
     int nswap = swap_size / 4;
+    // 이전에 만든 인스턴스가 남아있으면 먼저 해제한다
+    if (meta_base) ku_mmu_destroy();
+#if defined(KU_MMU_TRACE) && defined(KU_MMU_TRACE_FILE)
+    // ku_mmu_print.h 처럼 파일 이름을 정해 두고 빌드했으면 처음 init 할 때 trace 를 시작한다
+    if (ev_fd < 0) ku_mmu_trace_start(KU_MMU_TRACE_FILE);
+#endif
+    // 인스턴스 전체를 바꾸는 동안 다른 entry point 가 끼어들지 못하게 한다
+    pthread_mutex_lock(&mmu_lock);
     pfl_sz = npage;
     spl_sz = nswap;
-    // mem size, swap size 크기 조건 검사
-    // 물리 메모리 할당
-    pmem = malloc(pmem_size);  // npage 로 하지 않은 것이 에러의 원인이 될 수도 있다
-    memset(pmem, 0, pmem_size);
-    // 스왑 공간 메모리 할당
-    smem = malloc(swap_size);  // nswap 으로 하지 않은 것이 에러의 원인이 될 수도 있다
-    memset(smem, 0, swap_size);
-    // pg_free_list 초기화 (0 번 페이지는 제외 처리)
-    pg_free_list = (PFRI*)malloc(sizeof(PFRI) * npage);
-    for (int i = 1; i < npage; ++i) {
-        pg_free_list[i].page = (Page *)pmem + i;  // 사용되지 않은 페이지의 엔트리는 전부 0 으로 할당되어 있어야 한다.
-        pg_free_list[i].type = P_TYPE_UNDEFINED;
-        pg_free_list[i].is_free = TRUE;
-    }
-    if (npage) {
-        pg_free_list[0].page = NULL;
-        pg_free_list[0].type = NOT_USED_TYPE;
-        pg_free_list[0].is_free = FALSE;
-    }
-    // sw_free_list 초기화
-    sp_list = (SPI*)malloc(sizeof(SPI) * nswap);
-    for (int i = 1; i < spl_sz; ++i) {
-        sp_list[i].page = (Page *)smem + i;
-        sp_list[i].is_free = TRUE;
-        sp_list[i].spn = i;
-    }
-    if (nswap) {
-        sp_list[0].page = NULL;
-        sp_list[0].pgtable = NULL;
-        sp_list[0].spn = 0;
-        sp_list[0].is_free = FALSE;
-    }
-    // pf_queue 초기화 
-    pgf_queue = (PGF_Queue*)malloc(sizeof(PGF_Queue));
-    pgf_queue->head = NULL;
-    pgf_queue->tail = NULL;
-    pgf_queue->len = 0;
+    pt_mode = pt_mode_next;
+    nr_free = npage ? npage - 1 : 0;
+    // 물리 메모리, 스왑 공간 할당 (anonymous mmap 이라 처음 접근할 때 커널이 0 으로 채워준다)
+    pmem_bytes = pmem_size;
+    smem_bytes = swap_size;
+    pmem_base = (Page*)mapZero(pmem_size);
+    smem_base = (Page*)mapZero(swap_size);
+    // PageFrame/스왑 페이지 정보는 한 영역에 모아서 할당한다.
+    // 모든 배열이 0 으로 채워진 상태가 곧 초기 상태 (전부 free, 큐는 비어있음) 이므로 초기화 루프가 필요 없다.
+    meta_size = getMetaSize(npage, nswap, pt_mode);
+    meta_base = mapZero(meta_size);
+    if (!pmem_base || !smem_base || !meta_base) {
+        unmapAll();
+        pthread_mutex_unlock(&mmu_lock);
+        return 0;
+    }
+    layoutMeta();
+    pgf_len = 0;
+    markReserved();
     // pcb_list 초기화
     pcb_list = (PCB_List*)malloc(sizeof(PCB_List));
     pcb_list->head = NULL;
     pcb_list->tail = NULL;
     pcb_list->len = 0;
+    memset(pcb_table, 0, sizeof(pcb_table));
+    setScanImpl(SCAN_AVX2);
+    vtime = 0;
+    ref_miss = -1;
+    ws_sample = 0;
+    oom_kills = 0;
+    resetStats();
+    TRACE_EV(EV_INIT, 0, 0, 0, npage, nswap, NULL);
+    pthread_mutex_unlock(&mmu_lock);
 
     // 물리 메모리 시작 주소 리턴 (fail 할 경우 0 리턴)
-    return pmem;
+    return pmem_base;
+}
+
+void ku_mmu_reset() {
+    /*
+        ku_mmu_init 직후의 빈 상태로 되돌린다. 할당된 영역은 그대로 다시 사용하고,
+        사용된 적 있는 page 와 스왑 페이지 (pf_hwm, sp_hwm 아래) 만 지우므로 비용은 설정된 크기가 아니라 사용한 양에 비례한다.
+        readahead, swap cluster, working set 등의 설정과 kswapd 는 그대로 유지된다. MMU 가 초기화되어 있지 않으면 아무것도 하지 않는다.
+    */
+    pthread_mutex_lock(&mmu_lock);
+    if (!meta_base) {
+        pthread_mutex_unlock(&mmu_lock);
+        return;
+    }
+    int np = pf_hwm, ns = sp_hwm;
+    markAll(np, ns);
+    if (pt_mode == PT_HASHED) {
+        // 사용 중인 PageFrame 이 걸린 bucket 만 비운다
+        for (int i = 1; i < np; ++i)
+            if (pf_type[i] == PF_TYPE) ipt_head[iptHash(pf_pid[i], pf_fadd[i] >> PT_SHIFT)] = 0;
+        memset(pf_hnext, 0, sizeof(int) * np);
+    }
+    memset(pmem_base, 0, sizeof(Page) * np);
+    memset(smem_base, 0, sizeof(Page) * ns);
+    memset(pf_last_ref, 0, sizeof(int) * np);
+    memset(pf_pgtable, 0, sizeof(int) * np);
+    memset(pf_prev, 0, sizeof(int) * np);
+    memset(pf_next, 0, sizeof(int) * np);
+    memset(pf_type, 0, np);
+    memset(pf_used, 0, np);
+    memset(pf_pid, 0, np);
+    memset(pf_ref, 0, np);
+    memset(pf_ptenti, 0, np);
+    memset(pf_fadd, 0, np);
+    memset(sp_pgtable, 0, sizeof(int) * ns);
+    memset(sp_last_ref, 0, sizeof(int) * ns);
+    memset(sp_used, 0, ns);
+    memset(sp_pid, 0, ns);
+    memset(sp_fadd, 0, ns);
+    memset(sp_ptenti, 0, ns);
+    pgf_len = 0;
+    nr_free = pfl_sz ? pfl_sz - 1 : 0;
+    markReserved();
+    freePCBList(pcb_list);
+    vtime = 0;
+    ref_miss = -1;
+    ws_sample = 0;
+    oom_kills = 0;
+    resetStats();
+    oom_last_victim = 0;
+    TRACE_EV(EV_RESET, 0, 0, 0, 0, 0, NULL);
+    pthread_mutex_unlock(&mmu_lock);
+}
+
+void* mapSnapRegion(int fd, unsigned long long off, size_t len, size_t size) {
+    /*
+        size 바이트의 0 으로 채워진 영역을 만들고, 앞쪽 len 바이트에 snapshot 파일의 off 위치를 private 하게 mmap 한다.
+        (쓰기는 copy-on-write 로 처리되어 snapshot 파일은 바뀌지 않는다) 실패하면 NULL 반환.
+    */
+    void* p = mapZero(size);
+    if (p && len && mmap(p, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, (off_t)off) == MAP_FAILED) {
+        munmap(p, size ? size : 1);
+        return NULL;
+    }
+    return p;
+}
+
+int writeSnapRegion(FILE* fp, unsigned long long off, const void* data, size_t len) {
+    if (fseek(fp, (long)off, SEEK_SET)) return -1;
+    return fwrite(data, 1, len, fp) == len ? 0 : -1;
+}
+
+int ku_mmu_snapshot(const char* path) {
+    /*
+        현재 MMU 상태 (물리 메모리, 스왑 공간, PageFrame/스왑 페이지 정보, PageFrame 큐, PCB, 설정값) 를 path 에 저장한다.
+        성공하면 0, 실패하면 -1 반환.
+    */
+    Snap_Header h;
+    long pgsz = sysconf(_SC_PAGESIZE);
+    FILE* fp;
+    int ret = 0;
+
+    pthread_mutex_lock(&mmu_lock);
+    if (!meta_base || (fp = fopen(path, "wb")) == NULL) {
+        pthread_mutex_unlock(&mmu_lock);
+        return -1;
+    }
+    memset(&h, 0, sizeof(h));
+    h.magic = SNAP_MAGIC;
+    h.version = SNAP_VERSION;
+    h.npcb = pcb_list->len;
+    h.pmem_bytes = pmem_bytes;
+    h.smem_bytes = smem_bytes;
+    h.meta_size = meta_size;
+    h.pmem_len = sizeof(Page) * pf_hwm;
+    h.smem_len = sizeof(Page) * sp_hwm;
+    h.pmem_off = (sizeof(h) + sizeof(PCB_Snap) * h.npcb + pgsz - 1) / pgsz * pgsz;
+    h.smem_off = (h.pmem_off + h.pmem_len + pgsz - 1) / pgsz * pgsz;
+    h.meta_off = (h.smem_off + h.smem_len + pgsz - 1) / pgsz * pgsz;
+    h.pfl_sz = pfl_sz;
+    h.spl_sz = spl_sz;
+    h.pf_hwm = pf_hwm;
+    h.sp_hwm = sp_hwm;
+    h.pgf_len = pgf_len;
+    h.nr_free = nr_free;
+    h.vtime = vtime;
+    h.ws_sample = ws_sample;
+    h.oom_kills = oom_kills;
+    h.oom_last_victim = oom_last_victim;
+    h.ra_max = ra_max;
+    h.swap_cluster = swap_cluster;
+    h.ws_interval = ws_interval;
+    h.ws_tau = ws_tau;
+    h.load_control = load_control;
+    h.pt_mode = pt_mode;
+    h.superpage = superpage;
+    if (fwrite(&h, sizeof(h), 1, fp) != 1) ret = -1;
+    for (PCB* pcb = pcb_list->head; pcb != NULL && ret == 0; pcb = pcb->next) {
+        PCB_Snap ps;
+        memset(&ps, 0, sizeof(ps));
+        ps.pgdir = pcb->pgdir ? pcb->pgdir - pmem_base : 0;
+        ps.pid = pcb->pid;
+        ps.ra_win = pcb->ra_win;
+        ps.ra_lo = pcb->ra_lo;
+        ps.ra_hi = pcb->ra_hi;
+        ps.rss = pcb->rss;
+        ps.nswap = pcb->nswap;
+        ps.rss_soft = pcb->rss_soft;
+        ps.rss_max = pcb->rss_max;
+        ps.wss = pcb->wss;
+        ps.prio = pcb->prio;
+        ps.suspended = pcb->suspended;
+        ps.lc_since = pcb->lc_since;
+        if (fwrite(&ps, sizeof(ps), 1, fp) != 1) ret = -1;
+    }
+    if (ret == 0) ret = writeSnapRegion(fp, h.pmem_off, pmem_base, h.pmem_len);
+    if (ret == 0) ret = writeSnapRegion(fp, h.smem_off, smem_base, h.smem_len);
+    if (ret == 0) ret = writeSnapRegion(fp, h.meta_off, meta_base, meta_size);
+    if (fclose(fp)) ret = -1;
+    pthread_mutex_unlock(&mmu_lock);
+    return ret;
+}
+
+int checkSnapHeader(int fd, const Snap_Header* h) {
+    /*
+        snapshot 헤더가 스스로 맞는지, 파일이 헤더가 가리키는 영역을 모두 담고 있는지 확인한다. (잘린 파일을 mmap 하면 접근할 때 SIGBUS)
+        맞으면 0, 아니면 -1 반환.
+    */
+    struct stat st;
+    if (fstat(fd, &st) < 0) return -1;
+    unsigned long long fsize = (unsigned long long)st.st_size;
+    if (h->npcb < 0 || h->npcb > 256 || h->pfl_sz < 0 || h->spl_sz < 0) return -1;
+    if (h->pt_mode != PT_RADIX && h->pt_mode != PT_HASHED) return -1;
+    if ((unsigned long long)h->pfl_sz != h->pmem_bytes / 4 || (unsigned long long)h->spl_sz != h->smem_bytes / 4) return -1;
+    if (h->pf_hwm < 0 || h->pf_hwm > h->pfl_sz || h->sp_hwm < 0 || h->sp_hwm > h->spl_sz) return -1;
+    if (h->pmem_len > h->pmem_bytes || h->smem_len > h->smem_bytes) return -1;
+    if (h->meta_size != getMetaSize(h->pfl_sz, h->spl_sz, h->pt_mode)) return -1;
+    if (fsize < sizeof(*h) + sizeof(PCB_Snap) * (unsigned long long)h->npcb) return -1;
+    if (fsize < h->pmem_off + h->pmem_len || fsize < h->smem_off + h->smem_len || fsize < h->meta_off + h->meta_size) return -1;
+    return 0;
+}
+
+void* ku_mmu_restore(const char* path) {
+    /*
+        ku_mmu_snapshot 으로 저장한 상태로 MMU 를 되돌린다. (기존 인스턴스는 해제된다)
+        물리 메모리, 스왑 공간, 메타데이터 영역은 파일을 private mmap 하므로 크기와 상관없이 바로 끝나고,
+        실제로 접근하는 page 만 읽어온다. 물리 메모리 시작 주소를 반환하고, 실패하면 0 반환.
+    */
+    Snap_Header h;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    if (pread(fd, &h, sizeof(h), 0) != sizeof(h) || h.magic != SNAP_MAGIC || h.version != SNAP_VERSION
+        || checkSnapHeader(fd, &h) < 0) {
+        close(fd);
+        return 0;
+    }
+    if (meta_base) ku_mmu_destroy();
+    // 인스턴스 전체를 바꾸는 동안 다른 entry point 가 끼어들지 못하게 한다
+    pthread_mutex_lock(&mmu_lock);
+    pmem_bytes = h.pmem_bytes;
+    smem_bytes = h.smem_bytes;
+    meta_size = h.meta_size;
+    pmem_base = (Page*)mapSnapRegion(fd, h.pmem_off, h.pmem_len, pmem_bytes);
+    smem_base = (Page*)mapSnapRegion(fd, h.smem_off, h.smem_len, smem_bytes);
+    meta_base = mapSnapRegion(fd, h.meta_off, meta_size, meta_size);
+    if (!pmem_base || !smem_base || !meta_base) {
+        unmapAll();
+        pthread_mutex_unlock(&mmu_lock);
+        close(fd);
+        return 0;
+    }
+    pfl_sz = h.pfl_sz;
+    spl_sz = h.spl_sz;
+    pt_mode = h.pt_mode;
+    pt_mode_next = h.pt_mode;  // 다음 ku_mmu_init 도 복원한 주소 변환 구조를 쓴다
+    superpage = h.superpage;
+    layoutMeta();
+    pf_hwm = h.pf_hwm;
+    sp_hwm = h.sp_hwm;
+    pgf_len = h.pgf_len;
+    nr_free = h.nr_free;
+    vtime = h.vtime;
+    ref_miss = -1;
+    ws_sample = h.ws_sample;
+    oom_kills = h.oom_kills;
+    oom_last_victim = h.oom_last_victim;
+    resetStats();
+    ra_max = h.ra_max;
+    swap_cluster = h.swap_cluster;
+    ws_interval = h.ws_interval;
+    ws_tau = h.ws_tau;
+    load_control = h.load_control;
+    // pcb_list 를 저장된 순서대로 다시 만든다
+    pcb_list = (PCB_List*)malloc(sizeof(PCB_List));
+    pcb_list->head = NULL;
+    pcb_list->tail = NULL;
+    pcb_list->len = 0;
+    memset(pcb_table, 0, sizeof(pcb_table));
+    for (int i = 0; i < h.npcb; ++i) {
+        PCB_Snap ps;
+        if (pread(fd, &ps, sizeof(ps), sizeof(h) + sizeof(ps) * i) != sizeof(ps)) {
+            pthread_mutex_unlock(&mmu_lock);
+            close(fd);
+            ku_mmu_destroy();
+            return 0;
+        }
+        PCB* pcb = addPCB(pcb_list, ps.pid);
+        pcb->pgdir = getPage(ps.pgdir);
+        pcb->ra_win = ps.ra_win;
+        pcb->ra_lo = ps.ra_lo;
+        pcb->ra_hi = ps.ra_hi;
+        pcb->rss = ps.rss;
+        pcb->nswap = ps.nswap;
+        pcb->rss_soft = ps.rss_soft;
+        pcb->rss_max = ps.rss_max;
+        pcb->wss = ps.wss;
+        pcb->prio = ps.prio;
+        pcb->suspended = ps.suspended;
+        pcb->lc_since = ps.lc_since;
+    }
+    close(fd);
+    setScanImpl(SCAN_AVX2);
+#ifdef KU_MMU_TRACE
+    if (ev_fd >= 0) traceState();
+#endif
+    pthread_mutex_unlock(&mmu_lock);
+    return pmem_base;
+}
+
+void ku_set_readahead(int max_window) {
+    /*
+        swap in 할 때 같은 PageTable 의 이웃 페이지를 최대 몇 개까지 함께 가져올지 설정한다.
+        0 이면 readahead 를 하지 않고, RA_MAX_WINDOW 보다 크면 RA_MAX_WINDOW 로 맞춘다.
+    */
+    if (max_window < 0) max_window = 0;
+    if (max_window > RA_MAX_WINDOW) max_window = RA_MAX_WINDOW;
+    ra_max = max_window;
+}
+
+void ku_set_swap_cluster(int n) {
+    /*
+        free page 가 없어 swap out 할 때, 같은 PageTable 의 페이지를 최대 n 개까지 함께 내보내도록 설정한다.
+        1 이면 기존처럼 한 페이지씩 내보낸다. (1 ~ SWAP_CLUSTER_MAX)
+    */
+    if (n < 1) n = 1;
+    if (n > SWAP_CLUSTER_MAX) n = SWAP_CLUSTER_MAX;
+    swap_cluster = n;
+}
+
+int ku_kswapd_start(int low, int high) {
+    /*
+        free page 수가 low 보다 작아지면 깨어나서 high 가 될 때까지 swap out 하는 background thread 를 시작한다.
+        page fault 경로에서는 대부분 free page 를 바로 얻을 수 있게 된다.
+        성공하면 0, 이미 돌고 있거나 watermark 가 잘못되었으면 -1 반환.
+    */
+    if (kswapd_running || low < 1 || high < low) return -1;
+    pthread_mutex_lock(&mmu_lock);
+    wmark_low = low;
+    wmark_high = high;
+    kswapd_running = TRUE;
+    pthread_mutex_unlock(&mmu_lock);
+    if (pthread_create(&kswapd_thread, NULL, kswapd, NULL)) {
+        kswapd_running = FALSE;
+        return -1;
+    }
+    return 0;
+}
+
+void ku_kswapd_stop() {
+    if (!kswapd_running) return;
+    pthread_mutex_lock(&mmu_lock);
+    kswapd_running = FALSE;
+    pthread_cond_signal(&kswapd_wait);
+    pthread_mutex_unlock(&mmu_lock);
+    pthread_join(kswapd_thread, NULL);
+}
+
+void ku_mmu_destroy() {
+    /*
+        kswapd 를 멈추고 ku_mmu_init 에서 할당한 모든 영역을 해제한다.
+        이후 다시 사용하려면 ku_mmu_init 을 호출해야 한다.
+    */
+    ku_kswapd_stop();
+    pthread_mutex_lock(&mmu_lock);
+    TRACE_FLUSH();
+    unmapAll();
+    if (pcb_list) {
+        freePCBList(pcb_list);
+        free(pcb_list);
+        pcb_list = NULL;
+    }
+    pgf_len = 0;
+    pthread_mutex_unlock(&mmu_lock);
+}
+
+int ku_set_mem_limit(char pid, int soft, int hard) {
+    /*
+        pid 가 사용할 수 있는 PageFrame 수를 제한한다. (0 이면 제한 없음)
+            - soft: 넘으면 reclaim 할 때 다른 process 보다 먼저 페이지를 빼앗긴다
+            - hard: 닿으면 새 페이지가 필요할 때 자신의 가장 오래된 페이지를 내보낸다
+        실행한 적이 없는 pid 면 -1 반환
+    */
+    PCB* pcb;
+    pthread_mutex_lock(&mmu_lock);
+    pcb = searchPCB(pid);
+    if (pcb) {
+        pcb->rss_soft = soft;
+        pcb->rss_max = hard;
+    }
+    pthread_mutex_unlock(&mmu_lock);
+    return pcb ? 0 : -1;
+}
+
+int ku_reference(char pid, unsigned char va) {
+    /*
+        pid 가 va 에 접근했음을 알린다. (CPU 시뮬레이터가 매 메모리 접근마다 호출)
+        매핑되어 있으면 해당 PageFrame 의 reference bit 를 세우고 0 을, 아니면 -1 을 반환한다. (-1 이면 ku_page_fault 필요)
+    */
+    int pfn = 0;
+    PCB* pcb;
+    pthread_mutex_lock(&mmu_lock);
+    tickClock();
+    pcb = searchPCB(pid);
+    if (pcb && (pcb->pgdir || pt_mode == PT_HASHED) && !pcb->suspended) pfn = walkPage(pcb, va);
+    if (pfn) pf_ref[pfn] = TRUE;
+    ref_miss = pfn ? -1 : ((unsigned char)pid << 8 | va);
+    pthread_mutex_unlock(&mmu_lock);
+    return pfn ? 0 : -1;
+}
+
+void ku_ws_config(int interval, int tau, FILE* log) {
+    /*
+        working set 추정을 설정한다.
+            - interval: 메모리 접근 (ku_reference, ku_reference 없이 온 ku_page_fault) 몇 번마다 reference bit 를 샘플링할지 (0 이면 끔)
+            - tau: 최근 몇 번의 샘플 안에 참조된 페이지를 working set 으로 볼지
+            - log: NULL 이 아니면 샘플마다 pid 별 working set 크기를 기록한다
+    */
+    pthread_mutex_lock(&mmu_lock);
+    ws_interval = interval > 0 ? interval : 0;
+    ws_tau = tau > 0 ? tau : 1;
+    ws_log = log;
+    pthread_mutex_unlock(&mmu_lock);
+}
+
+void ku_load_control(int on) {
+    /*
+        working set 합이 물리 메모리보다 커지면 우선순위가 낮은 process 를 suspend 하는 모드를 켜고 끈다.
+        (ku_ws_config 로 working set 추정을 켜야 동작한다)
+        suspend 된 process 는 ku_run_proc, ku_page_fault 가 -1 을 반환하고, 여유가 생기면 다시 깨어난다.
+    */
+    pthread_mutex_lock(&mmu_lock);
+    load_control = on;
+    if (!on) {
+        for (PCB* pcb = pcb_list->head; pcb != NULL; pcb = pcb->next) pcb->suspended = FALSE;
+    }
+    pthread_mutex_unlock(&mmu_lock);
+}
+
+int ku_set_priority(char pid, int prio) {
+    PCB* pcb;
+    pthread_mutex_lock(&mmu_lock);
+    pcb = searchPCB(pid);
+    if (pcb) pcb->prio = prio;
+    pthread_mutex_unlock(&mmu_lock);
+    return pcb ? 0 : -1;
+}
+
+int ku_get_wss(char pid) {
+    PCB* pcb;
+    int wss;
+    pthread_mutex_lock(&mmu_lock);
+    pcb = searchPCB(pid);
+    wss = pcb ? pcb->wss : -1;
+    pthread_mutex_unlock(&mmu_lock);
+    return wss;
+}
+
+int ku_is_suspended(char pid) {
+    PCB* pcb;
+    int suspended;
+    pthread_mutex_lock(&mmu_lock);
+    pcb = searchPCB(pid);
+    suspended = pcb ? pcb->suspended : FALSE;
+    pthread_mutex_unlock(&mmu_lock);
+    return suspended;
+}
+
+int ku_get_rss(char pid) {
+    PCB* pcb;
+    int rss;
+    pthread_mutex_lock(&mmu_lock);
+    pcb = searchPCB(pid);
+    rss = pcb ? pcb->rss : -1;
+    pthread_mutex_unlock(&mmu_lock);
+    return rss;
+}
+
+int ku_get_swap_usage(char pid) {
+    PCB* pcb;
+    int nswap;
+    pthread_mutex_lock(&mmu_lock);
+    pcb = searchPCB(pid);
+    nswap = pcb ? pcb->nswap : -1;
+    pthread_mutex_unlock(&mmu_lock);
+    return nswap;
+}
+
+unsigned long ku_fault_count(int kind) {
+    /*
+        kind (FAULT_MAPPED/FAULT_FIRST/FAULT_TABLE/FAULT_SWAPIN/FAULT_FAIL) 결과로 끝난 page fault 수.
+        kind 가 FAULT_NR 이면 전체 page fault 수를 반환한다.
+    */
+    unsigned long n = 0;
+    if (kind >= 0 && kind < FAULT_NR) return fault_cnt[kind];
+    for (int k = 0; k < FAULT_NR; ++k) n += fault_cnt[k];
+    return n;
+}
+
+unsigned long ku_fault_count_pid(char pid, int kind) {
+    unsigned long n = 0;
+    if (kind >= 0 && kind < FAULT_NR) return pid_fault_cnt[(unsigned char)pid][kind];
+    for (int k = 0; k < FAULT_NR; ++k) n += pid_fault_cnt[(unsigned char)pid][k];
+    return n;
+}
+
+unsigned long ku_add_page_count(int how) {
+    return how >= 0 && how < ADD_NR ? add_cnt[how] : 0;
+}
+
+long long ku_fault_latency(int kind, double q) {
+    /*
+        kind 결과로 끝난 page fault 처리 시간의 q 분위수 (0 <= q <= 1) 를 ns 로 반환한다. (bucket 하한, 오차 12.5% 이내)
+        kind 가 FAULT_NR 이면 전체 page fault 를 대상으로 한다. 해당하는 fault 가 없으면 -1 반환.
+    */
+    unsigned long n = ku_fault_count(kind), acc = 0, target;
+    long long max = 0;
+    if (n == 0) return -1;
+    for (int k = 0; k < FAULT_NR; ++k)
+        if ((kind == FAULT_NR || kind == k) && lat_max[k] > max) max = lat_max[k];
+    if (q >= 1) return max;
+    target = q <= 0 ? 1 : (unsigned long)(q * n + 0.999999);
+    for (int b = 0; b < LAT_BUCKETS; ++b) {
+        for (int k = 0; k < FAULT_NR; ++k)
+            if (kind == FAULT_NR || kind == k) acc += lat_hist[k][b];
+        if (acc >= target) return latBucketLow(b) < max ? latBucketLow(b) : max;
+    }
+    return max;
+}
+
+void ku_set_superpage(int on) {
+    /*
+        PageTable 이 pfn 이 이어진 PageFrame 4 개로 꽉 차면 PageMidDir 엔트리 하나로 매핑 (superpage) 할지 정한다. (기본값 FALSE)
+        켜져 있으면 PageFrame 을 할당할 때 같은 PageTable 의 PageFrame 들과 이어지는 free page 를 먼저 쓰고,
+        superpage 의 일부를 swap out 해야 하면 다시 PageTable 로 되돌린다. 끄더라도 이미 만든 superpage 는 그대로 쓴다.
+        PT_RADIX 에서만 의미가 있다. (PT_HASHED 에는 PageMidDir 단계가 없다)
+    */
+    pthread_mutex_lock(&mmu_lock);
+    superpage = on ? TRUE : FALSE;
+    pthread_mutex_unlock(&mmu_lock);
+}
+
+int ku_set_pt_mode(int mode) {
+    /*
+        다음 ku_mmu_init 부터 쓸 주소 변환 구조 (PT_RADIX/PT_HASHED) 를 정한다. (지금 인스턴스는 그대로)
+        PT_HASHED 에서는 PageDir/PageMidDir/PageTable 을 할당하지 않으므로 ku_run_proc 의 ku_cr3 는 NULL 이고,
+        접근이 매핑되어 있는지는 ku_reference 로 확인한다. 나머지 API 는 같다. 잘못된 mode 면 -1 반환.
+    */
+    if (mode != PT_RADIX && mode != PT_HASHED) return -1;
+    pthread_mutex_lock(&mmu_lock);
+    pt_mode_next = mode;
+    pthread_mutex_unlock(&mmu_lock);
+    return 0;
+}
+
+void ku_set_pwc(int on) {
+    /*
+        page fault 의 page walk 에서 paging-structure cache 를 쓸지 정한다. (기본값 TRUE)
+        다시 켤 때는 꺼져 있던 동안 채우지 않은 cache 를 모두 비우고 시작한다.
+    */
+    pthread_mutex_lock(&mmu_lock);
+    if (on && !pwc_on && pcb_list)
+        for (PCB* pcb = pcb_list->head; pcb != NULL; pcb = pcb->next) pwcFlush(pcb);
+    pwc_on = on ? TRUE : FALSE;
+    pthread_mutex_unlock(&mmu_lock);
+}
+
+unsigned long ku_walk_count(int refs) {
+    /*
+        엔트리를 refs 개 (1 ~ WALK_REFS_MAX, WALK_REFS_MAX 는 그 이상 포함) 읽은 page walk 수.
+        refs 가 0 이면 전체 page walk 수를 반환한다.
+    */
+    unsigned long n = 0;
+    if (refs > 0 && refs <= WALK_REFS_MAX) return walk_cnt[refs];
+    for (int r = 1; r <= WALK_REFS_MAX; ++r) n += walk_cnt[r];
+    return n;
+}
+
+double ku_walk_avg_refs() {
+    /*
+        page walk 하나당 읽은 엔트리 수 (메모리 참조 수) 의 평균. page walk 가 없었으면 0.
+    */
+    return ku_walk_count(0) ? (double)walk_refs / ku_walk_count(0) : 0;
+}
+
+double ku_pwc_hit_rate(int level) {
+    /*
+        level (PWC_PD/PWC_PMD) cache 의 hit 비율. 찾아본 적이 없으면 -1 반환.
+        PWC_PD cache 는 PWC_PMD cache 가 miss 일 때만 찾는다.
+    */
+    if (level != PWC_PD && level != PWC_PMD) return -1;
+    unsigned long n = pwc_hit[level] + pwc_miss[level];
+    return n ? (double)pwc_hit[level] / n : -1;
+}
+
+void ku_perf_stop();
+
+int ku_perf_start() {
+    /*
+        호출한 thread 에 cycles, instructions, cache misses, branch misses counter 를 연다. (user 영역만 센다)
+        이후 이 thread 가 호출한 ku_page_fault 는 처리 전후로 counter 를 읽어서 결과별로 모은다. (ku_perf_fault_avg)
+        일부 counter 만 열리면 나머지는 빼고 잰다. 열린 counter 수를 반환하고, 하나도 열지 못하면 -1 반환.
+    */
+#ifdef __linux__
+    static const unsigned long long config[PERF_NR] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+    };
+    struct perf_event_attr attr;
+    ku_perf_stop();
+    pthread_mutex_lock(&mmu_lock);
+    perf_mask = 0;
+    for (int c = 0; c < PERF_NR; ++c) {
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = config[c];
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.disabled = perf_leader < 0;  // group 은 leader 를 켤 때 함께 시작한다
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        perf_fd[c] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, perf_leader, 0);
+        if (perf_fd[c] < 0) continue;
+        if (perf_leader < 0) perf_leader = perf_fd[c];
+        perf_pos[c] = perf_nr++;
+        perf_mask |= 1 << c;
+    }
+    if (perf_leader >= 0) {
+        perf_thread = pthread_self();
+        ioctl(perf_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    pthread_mutex_unlock(&mmu_lock);
+    return perf_nr ? perf_nr : -1;
+#else
+    return -1;
+#endif
+}
+
+void ku_perf_stop() {
+    /*
+        counter 를 닫는다. 지금까지 모은 결과별 값은 ku_mmu_reset/ku_mmu_init 전까지 남아있다.
+    */
+    pthread_mutex_lock(&mmu_lock);
+    for (int c = 0; c < PERF_NR; ++c) {
+        if (perf_fd[c] >= 0) close(perf_fd[c]);
+        perf_fd[c] = -1;
+    }
+    perf_leader = -1;
+    perf_nr = 0;
+    pthread_mutex_unlock(&mmu_lock);
+}
+
+int ku_perf_read(long long v[PERF_NR]) {
+    /*
+        ku_perf_start 이후 counter 들의 누적값을 v 에 채운다. (열리지 않은 counter 는 -1)
+        replay 루프처럼 여러 호출을 묶은 구간은 앞뒤로 읽어서 뺀다. counter 가 꺼져 있으면 -1 반환.
+    */
+    unsigned long long pc[PERF_NR];
+    pthread_mutex_lock(&mmu_lock);
+    if (readPerf(pc)) {
+        pthread_mutex_unlock(&mmu_lock);
+        return -1;
+    }
+    for (int c = 0; c < PERF_NR; ++c) v[c] = perf_fd[c] >= 0 ? (long long)pc[c] : -1;
+    pthread_mutex_unlock(&mmu_lock);
+    return 0;
+}
+
+double ku_perf_fault_avg(int kind, int counter) {
+    /*
+        counter 를 읽은 page fault 중 kind 결과로 끝난 것의 fault 하나당 counter 평균.
+        kind 가 FAULT_NR 이면 전체 page fault 평균. 잰 fault 가 없거나 counter 가 없으면 -1 반환.
+    */
+    unsigned long n = 0;
+    unsigned long long sum = 0;
+    if (counter < 0 || counter >= PERF_NR || !(perf_mask & (1 << counter))) return -1;
+    for (int k = 0; k < FAULT_NR; ++k) {
+        if (kind != FAULT_NR && kind != k) continue;
+        n += perf_cnt[k];
+        sum += perf_sum[k][counter];
+    }
+    return n ? (double)sum / n : -1;
+}
+
+unsigned long ku_perf_fault_count(int kind) {
+    /*
+        counter 를 읽은 page fault 중 kind 결과로 끝난 수 (kind 가 FAULT_NR 이면 전체)
+    */
+    unsigned long n = 0;
+    for (int k = 0; k < FAULT_NR; ++k)
+        if (kind == FAULT_NR || kind == k) n += perf_cnt[k];
+    return n;
+}
+
+long ku_pt_bytes();
+
+void ku_fault_stats_json(FILE* fp) {
+    /*
+        page fault/addPage 결과별 횟수, swap 횟수, superpage 승격/분할 횟수, 결과별 처리 시간 분포, page walk 비용, pid 별 횟수를 JSON 으로 출력한다.
+    */
+    const char* add_name[ADD_NR] = { "free", "reclaim", "oom", "fail" };
+    int first;
+
+    pthread_mutex_lock(&mmu_lock);
+    fprintf(fp, "{\n  \"faults\": {");
+    for (int k = 0; k < FAULT_NR; ++k) fprintf(fp, "\"%s\": %lu, ", fault_name[k], fault_cnt[k]);
+    fprintf(fp, "\"total\": %lu},\n", ku_fault_count(FAULT_NR));
+    fprintf(fp, "  \"add_page\": {");
+    for (int k = 0; k < ADD_NR; ++k) fprintf(fp, "%s\"%s\": %lu", k ? ", " : "", add_name[k], add_cnt[k]);
+    fprintf(fp, "},\n  \"swap\": {\"in\": %lu, \"out\": %lu},\n", nr_swapin, nr_swapout);
+    fprintf(fp, "  \"superpage\": {\"promote\": %lu, \"demote\": %lu},\n", nr_promote, nr_demote);
+    fprintf(fp, "  \"latency_ns\": {");
+    for (int k = 0; k < FAULT_NR; ++k) {
+        fprintf(fp, "%s\n    \"%s\": {\"count\": %lu", k ? "," : "", fault_name[k], fault_cnt[k]);
+        if (fault_cnt[k]) {
+            fprintf(fp, ", \"mean\": %.1f, \"p50\": %lld, \"p90\": %lld, \"p99\": %lld, \"max\": %lld",
+                (double)lat_sum[k] / fault_cnt[k], ku_fault_latency(k, 0.5), ku_fault_latency(k, 0.9),
+                ku_fault_latency(k, 0.99), lat_max[k]);
+        }
+        fprintf(fp, ", \"buckets\": [");
+        first = TRUE;
+        for (int b = 0; b < LAT_BUCKETS; ++b) {
+            if (!lat_hist[k][b]) continue;
+            fprintf(fp, "%s[%lld, %lu]", first ? "" : ", ", latBucketLow(b), lat_hist[k][b]);
+            first = FALSE;
+        }
+        fprintf(fp, "]}");
+    }
+    fprintf(fp, "\n  },\n  \"walk\": {\"pt_mode\": \"%s\", \"pt_bytes\": %ld, \"count\": %lu, \"mean_refs\": %.3f, \"refs\": {",
+        pt_mode == PT_HASHED ? "hashed" : "radix", ku_pt_bytes(), ku_walk_count(0), ku_walk_avg_refs());
+    for (int r = 1; r <= WALK_REFS_MAX; ++r) fprintf(fp, "%s\"%d\": %lu", r > 1 ? ", " : "", r, walk_cnt[r]);
+    fprintf(fp, "},\n    \"pwc\": {\"pd\": {\"hit\": %lu, \"miss\": %lu}, \"pmd\": {\"hit\": %lu, \"miss\": %lu}}",
+        pwc_hit[PWC_PD], pwc_miss[PWC_PD], pwc_hit[PWC_PMD], pwc_miss[PWC_PMD]);
+    if (ku_perf_fault_count(FAULT_NR)) {
+        fprintf(fp, "\n  },\n  \"perf\": {");
+        for (int k = 0; k < FAULT_NR; ++k) {
+            fprintf(fp, "%s\n    \"%s\": {\"count\": %lu", k ? "," : "", fault_name[k], perf_cnt[k]);
+            for (int c = 0; c < PERF_NR; ++c)
+                if (perf_cnt[k] && (perf_mask & (1 << c))) fprintf(fp, ", \"%s\": %.1f", perf_name[c], ku_perf_fault_avg(k, c));
+            fprintf(fp, "}");
+        }
+    }
+    fprintf(fp, "\n  },\n  \"pids\": {");
+    first = TRUE;
+    for (int pid = 0; pid < 256; ++pid) {
+        if (!ku_fault_count_pid((char)pid, FAULT_NR)) continue;
+        fprintf(fp, "%s\n    \"%d\": {", first ? "" : ",", (char)pid);
+        for (int k = 0; k < FAULT_NR; ++k) fprintf(fp, "%s\"%s\": %lu", k ? ", " : "", fault_name[k], pid_fault_cnt[pid][k]);
+        fprintf(fp, "}");
+        first = FALSE;
+    }
+    fprintf(fp, "\n  }\n}\n");
+    pthread_mutex_unlock(&mmu_lock);
+}
+
+int ku_count_pages(char type) {
+    /*
+        type 으로 쓰이고 있는 page 의 수를 반환한다. (P_TYPE_UNDEFINED 를 넘기면 free page 의 수)
+    */
+    return pfl_sz ? count_byte(pf_type + 1, pfl_sz - 1, type) : 0;
+}
+
+long ku_pt_bytes() {
+    /*
+        지금 주소 변환 구조가 쓰는 메모리 (바이트)
+        : PT_RADIX 면 사용 중인 PageDir/PageMidDir/PageTable page 의 크기 합, PT_HASHED 면 bucket 과 pf_hnext 배열의 크기.
+    */
+    if (pt_mode == PT_HASHED) return pfl_sz ? (long)sizeof(int) * ((1L << ipt_bits) + pfl_sz) : 0;
+    return (long)sizeof(Page) * (ku_count_pages(PD_TYPE) + ku_count_pages(PMD_TYPE) + ku_count_pages(PT_TYPE));
+}
+
+int ku_set_scan_impl(int level) {
+    /*
+        메타데이터를 훑는 커널을 level (SCAN_SCALAR/SCAN_SSE2/SCAN_AVX2) 이하에서 CPU 가 지원하는 것으로 바꾸고,
+        실제로 고른 커널 종류를 반환한다. ku_mmu_init 은 지원되는 가장 빠른 커널을 고른다.
+    */
+    return setScanImpl(level);
+}
+
+int ku_dump_start() {
+    /*
+        change log 를 켠다. 첫 ku_dump_changes 는 지금까지 사용된 적 있는 (pf_hwm, sp_hwm 아래) page 와 스왑 페이지를 모두 출력한다.
+        ku_mmu_init, ku_mmu_restore, ku_mmu_destroy 를 하면 꺼진다. MMU 가 초기화되어 있지 않으면 -1 반환.
+    */
+    pthread_mutex_lock(&mmu_lock);
+    if (!meta_base) {
+        pthread_mutex_unlock(&mmu_lock);
+        return -1;
+    }
+    if (!chg_base) {
+        chg_size = (sizeof(int) + 1) * (pfl_sz + spl_sz) + 8 * 4;
+        if ((chg_base = mapZero(chg_size)) == NULL) {
+            pthread_mutex_unlock(&mmu_lock);
+            return -1;
+        }
+        chg_pf = (int*)chg_base;
+        chg_sp = chg_pf + pfl_sz;
+        pf_dirty = (char*)(chg_sp + spl_sz);
+        sp_dirty = pf_dirty + pfl_sz;
+        nchg_pf = nchg_sp = 0;
+        chg_seq = 0;
+        markAll(pf_hwm, sp_hwm);
+    }
+    pthread_mutex_unlock(&mmu_lock);
+    return 0;
+}
+
+void ku_dump_stop() {
+    pthread_mutex_lock(&mmu_lock);
+    if (chg_base) munmap(chg_base, chg_size);
+    chg_base = NULL;
+    nchg_pf = nchg_sp = 0;
+    pthread_mutex_unlock(&mmu_lock);
+}
+
+int ku_dump_changes(FILE* fp) {
+    /*
+        마지막 ku_dump_changes (또는 ku_dump_start) 이후 바뀐 page, 스왑 페이지와 그 중 PageFrame 큐에 있는 PageFrame 만
+        pt_pg_free_list, pt_sp_list, pt_pgf_queue 와 같은 형식으로 출력하고 change log 를 비운다.
+        비용은 바뀐 항목 수에만 비례하고, 출력은 한 번의 fwrite 로 한다.
+        (process 가 PageFrame 에 직접 쓴 내용은 MMU 가 알 수 없으므로 변경으로 잡히지 않고,
+         각 줄 끝의 pgtable entry 는 다른 page 의 값이라 출력하는 시점의 값이다)
+        출력한 page 와 스왑 페이지 수를 반환하고, change log 가 꺼져 있으면 -1 반환.
+    */
+    Dump_Buf* b = &dump_buf;
+    int n;
+    pthread_mutex_lock(&mmu_lock);
+    if (!chg_base) {
+        pthread_mutex_unlock(&mmu_lock);
+        return -1;
+    }
+    chg_seq++;
+    qsort(chg_pf, nchg_pf, sizeof(int), cmpInt);
+    qsort(chg_sp, nchg_sp, sizeof(int), cmpInt);
+    bufPrintf(b, "\n<changes #%d: pages %d, swap pages %d, pgf_queue len %d, free pages %d>\n", chg_seq, nchg_pf, nchg_sp, pgf_len, nr_free);
+    bufPrintf(b, "  pg_free_list = [ \n");
+    for (int k = 0; k < nchg_pf; ++k) fmtPageRow(b, chg_pf[k]);
+    bufPrintf(b, "  ]\n  sp_list = [ \n");
+    for (int k = 0; k < nchg_sp; ++k) fmtSwapRow(b, chg_sp[k]);
+    bufPrintf(b, "  ]\n  pgf_queue = [\n");
+    for (int k = 0; k < nchg_pf; ++k) {
+        int pfn = chg_pf[k];
+        if (pf_used[pfn] && pf_type[pfn] == PF_TYPE) fmtQueueRow(b, -1, pfn);
+    }
+    bufPrintf(b, "  ]\n");
+    bufWrite(b, fp);
+    for (int k = 0; k < nchg_pf; ++k) pf_dirty[chg_pf[k]] = FALSE;
+    for (int k = 0; k < nchg_sp; ++k) sp_dirty[chg_sp[k]] = FALSE;
+    n = nchg_pf + nchg_sp;
+    nchg_pf = nchg_sp = 0;
+    pthread_mutex_unlock(&mmu_lock);
+    return n;
+}
+
+int ku_mmu_trace_start(const char* path) {
+    /*
+        MMU event 를 path 에 기록하기 시작한다. MMU 가 이미 초기화되어 있으면 현재 상태부터 기록한다.
+        KU_MMU_TRACE 없이 빌드했거나, 이미 기록 중이거나, 파일을 열 수 없으면 -1 반환.
+    */
+#ifdef KU_MMU_TRACE
+    Event_Header h;
+    int fd;
+    pthread_once(&ev_once, createEventKey);
+    pthread_mutex_lock(&mmu_lock);
+    if (ev_fd >= 0 || (fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644)) < 0) {
+        pthread_mutex_unlock(&mmu_lock);
+        return -1;
+    }
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, EVENT_MAGIC, 8);
+    h.version = EVENT_VERSION;
+    h.rec_size = sizeof(Event_Rec);
+    if (write(fd, &h, sizeof(h)) != sizeof(h)) {
+        close(fd);
+        pthread_mutex_unlock(&mmu_lock);
+        return -1;
+    }
+    ev_fd = fd;
+    ev_seq = 0;
+    ev_len = 0;
+    if (meta_base) traceState();
+    pthread_mutex_unlock(&mmu_lock);
+    return 0;
+#else
+    (void)path;
+    return -1;
+#endif
+}
+
+int ku_mmu_timeline_start(const char* path) {
+    /*
+        MMU event 를 Chrome Trace Event 형식의 JSON 으로 path 에 바로바로 써 나간다. (chrome://tracing, ui.perfetto.dev)
+        page fault (결과별), swap in/out, reclaim 구간, context switch, pid 별 rss counter 가 track 으로 나온다.
+        event trace (ku_mmu_trace_start) 와 따로 켜고 끌 수 있다.
+        KU_MMU_TRACE 없이 빌드했거나, 이미 쓰는 중이거나, 파일을 열 수 없으면 -1 반환.
+    */
+#ifdef KU_MMU_TRACE
+    FILE* fp;
+    pthread_once(&ev_once, createEventKey);
+    pthread_mutex_lock(&mmu_lock);
+    if (tl_fp || (fp = fopen(path, "w")) == NULL) {
+        pthread_mutex_unlock(&mmu_lock);
+        return -1;
+    }
+    setvbuf(fp, NULL, _IOFBF, 1 << 16);
+    tl_fp = fp;
+    tl_t0 = getNs();
+    tl_nev = 0;
+    tl_cur = -1;
+    memset(tl_named, 0, sizeof(tl_named));
+    fprintf(tl_fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    tlBegin("M", TL_TRACK_CPU, tl_t0);
+    fprintf(tl_fp, ",\"name\":\"process_name\",\"args\":{\"name\":\"ku_mmu\"}}");
+    tlName(TL_TRACK_CPU, "cpu");
+    tlName(TL_TRACK_DIRECT, "direct reclaim");
+    tlName(TL_TRACK_KSWAPD, "kswapd");
+    pthread_mutex_unlock(&mmu_lock);
+    return 0;
+#else
+    (void)path;
+    return -1;
+#endif
+}
+
+void ku_mmu_timeline_stop() {
+#ifdef KU_MMU_TRACE
+    pthread_mutex_lock(&mmu_lock);
+    if (tl_fp) {
+        tlSwitch(-1, getNs());
+        fprintf(tl_fp, "\n]}\n");
+        fclose(tl_fp);
+        tl_fp = NULL;
+    }
+    pthread_mutex_unlock(&mmu_lock);
+#endif
+}
+
+void ku_mmu_trace_flush() {
+    /*
+        호출한 thread 가 모아 둔 event 를 파일에 붙인다. (kswapd 는 잠들 때마다 스스로 flush 한다)
+    */
+#ifdef KU_MMU_TRACE
+    pthread_mutex_lock(&mmu_lock);
+    flushEvents();
+    pthread_mutex_unlock(&mmu_lock);
+#endif
+}
+
+void ku_mmu_trace_stop() {
+    /*
+        호출한 thread 의 event 를 flush 하고 trace 파일을 닫는다.
+    */
+#ifdef KU_MMU_TRACE
+    pthread_mutex_lock(&mmu_lock);
+    if (ev_fd >= 0) {
+        flushEvents();
+        close(ev_fd);
+        ev_fd = -1;
+    }
+    pthread_mutex_unlock(&mmu_lock);
+#endif
+}
+
+void ku_mmu_lock() {
+    /*
+        kswapd 가 돌고 있을 때, 페이지 테이블을 직접 읽고 쓰는 쪽(CPU 시뮬레이터 등)이
+        swap out 과 겹치지 않도록 잡는 lock
+    */
+    pthread_mutex_lock(&mmu_lock);
+}
+
+void ku_mmu_unlock() {
+    pthread_mutex_unlock(&mmu_lock);
 }
 
 int ku_run_proc(char pid, void **ku_cr3) {
-    PCB* npcb = searchPCB(pcb_list, pid); 
+    PCB* npcb;
 
+    pthread_mutex_lock(&mmu_lock);
+    npcb = searchPCB(pid);
     // 실행한 적이 없는 pid 일 때
     if (npcb == NULL) {
         // pcb 생성
         npcb = addPCB(pcb_list, pid);
-        Page* npage = pg_free_list[addPage(PD_TYPE)].page;
+        TRACE_EV(EV_PROC_NEW, pid, 0, 0, 0, 0, NULL);
+        // PT_HASHED 면 PageDir 가 없다 (ku_cr3 는 NULL 이고, 접근은 ku_reference 로 확인한다)
+        if (pt_mode == PT_HASHED) {
+            *ku_cr3 = NULL;
+            TRACE_EV(EV_RUN_PROC, pid, 0, 0, 0, 0, NULL);
+            pthread_mutex_unlock(&mmu_lock);
+            return 0;
+        }
+        Page* npage = getPage(addPage(PD_TYPE, pid));
+        wakeupKswapd();
         if (npage) npcb->pgdir = npage;
-        else return -1;
+        else {
+            // PageDir 가 없는 PCB 를 남겨두면 다음 호출이 NULL 인 cr3 로 성공하므로 지운다
+            removePCB(pcb_list, npcb);
+            TRACE_EV(EV_PROC_EXIT, pid, 0, 0, 0, 0, NULL);
+            TRACE_EV(EV_RUN_PROC, pid, 0, 1, 0, 0, NULL);
+            pthread_mutex_unlock(&mmu_lock);
+            return -1;
+        }
     } 
+    // load control 로 suspend 된 process 와 (radix 인데) PageDir 가 없는 process 는 실행할 수 없다
+    else if (npcb->suspended || (npcb->pgdir == NULL && pt_mode != PT_HASHED)) {
+        TRACE_EV(EV_RUN_PROC, pid, 0, 1, npcb->pgdir ? npcb->pgdir - pmem_base : 0, 0, NULL);
+        pthread_mutex_unlock(&mmu_lock);
+        return -1;
+    }
 
     *ku_cr3 = (void*)(npcb->pgdir);
+    TRACE_EV(EV_RUN_PROC, pid, 0, 0, npcb->pgdir ? npcb->pgdir - pmem_base : 0, 0, NULL);
+    pthread_mutex_unlock(&mmu_lock);
     return 0;  // success
 }
\ No newline at end of file
@@ -0,0 +1,280 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "ku_mmu.h"
+#include "ku_trace.h"
+
+/*
+    trace 파일의 메모리 접근을 순서대로 MMU 에 넣어보는 replay 드라이버
+
+    사용법: ku_replay [-s] [-p] [-H] [-S] [-j json] [-t timeline] <trace 파일> [pmem_size] [swap_size]
+        - pid 가 바뀌면 ku_run_proc 으로 context switch 하고
+        - 매 접근마다 ku_reference 로 접근을 알린 뒤, 매핑되어 있지 않으면 ku_page_fault 를 호출한다.
+        - 기본적으로 reader thread 가 레코드를 batch 로 풀어서 ring 으로 넘기고, main thread 는 MMU 호출만 한다.
+          -s 를 주면 한 thread 에서 읽으면서 바로 처리한다.
+        - -p 를 주면 main thread 의 hardware counter (cycles, instructions, cache/branch misses) 로
+          replay 루프 전체와 page fault 결과별 평균을 잰다. (reader thread 는 세지 않는다)
+        - -H 를 주면 radix page table 대신 hashed inverted page table 로 주소를 변환한다.
+        - -S 를 주면 PageTable 이 이어진 PageFrame 들로 꽉 찼을 때 PageMidDir 엔트리 하나로 매핑한다. (superpage)
+        - -j 를 주면 page fault 결과별 횟수와 처리 시간 분포를 json 파일로 저장한다.
+        - -t 를 주면 replay 동안의 timeline 을 Chrome trace json 으로 저장한다. (KU_MMU_TRACE 로 빌드했을 때만)
+*/
+
+/* pipeline */
+#define BATCH_MAX 256  // batch 하나에 담는 최대 접근 수
+#define RING_SIZE 64  // ring 의 batch 수 (2 의 거듭제곱)
+
+/*
+    batch
+    : 같은 pid 의 연속된 접근들. trace 순서는 바꾸지 않고, pid 가 바뀌거나 BATCH_MAX 개가 차면 끊는다.
+*/
+typedef struct batch_ {
+    unsigned char pid;
+    int n;
+    unsigned char va[BATCH_MAX];
+} Batch;
+
+/*
+    reader thread (producer) 와 main thread (consumer) 사이의 single-producer single-consumer ring
+        - head: consumer 가 다음에 꺼낼 위치 (consumer 만 쓴다)
+        - tail: producer 가 다음에 넣을 위치 (producer 만 쓴다)
+        - done: producer 가 마지막 batch 까지 넣었으면 TRUE
+*/
+typedef struct ring_ {
+    Batch slot[RING_SIZE];
+    _Alignas(64) atomic_ulong head;
+    _Alignas(64) atomic_ulong tail;
+    atomic_int done;
+} Ring;
+
+/*
+    replay 결과
+*/
+typedef struct replay_stat_ {
+    unsigned long long accesses;
+    unsigned long long blocked;  // suspend 되어 실행하지 못한 process 의 접근 수
+    unsigned long long switches;
+    unsigned long long stalls;  // ring 이 비어서 main thread 가 기다린 횟수
+    int cur;  // 현재 실행 중인 pid (-1 이면 없음)
+} Replay_Stat;
+
+Trace trace;
+Ring ring;
+
+
+
+
+double getTime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void replayBatch(Replay_Stat* st, unsigned char pid, const unsigned char* va, int n) {
+    /*
+        pid 의 연속된 접근 n 개를 처리한다.
+    */
+    void* ku_cr3;
+    for (int i = 0; i < n; ++i) {
+        // pid 가 바뀌면 context switch (suspend 된 process 는 실행될 때까지 접근을 건너뛴다)
+        if (pid != st->cur) {
+            if (ku_run_proc((char)pid, &ku_cr3) < 0) {
+                st->cur = -1;
+                st->blocked++;
+                continue;
+            }
+            st->cur = pid;
+            st->switches++;
+        }
+        st->accesses++;
+        if (ku_reference((char)pid, va[i]) < 0) ku_page_fault((char)pid, va[i]);
+    }
+}
+
+void* reader(void* arg) {
+    /*
+        trace 레코드를 batch 로 풀어서 ring 에 넣는다. ring 이 가득 차 있으면 빈 자리가 날 때까지 기다린다.
+    */
+    unsigned long tail = 0;
+    Batch* b = NULL;
+    (void)arg;
+    for (unsigned long long i = 0; i < trace.nrec; ++i) {
+        const Trace_Rec* r = trace.rec + i;
+        if (b && (b->pid != r->pid || b->n == BATCH_MAX)) {
+            atomic_store_explicit(&ring.tail, ++tail, memory_order_release);
+            b = NULL;
+        }
+        if (b == NULL) {
+            while (tail - atomic_load_explicit(&ring.head, memory_order_acquire) == RING_SIZE) sched_yield();
+            b = ring.slot + (tail & (RING_SIZE - 1));
+            b->pid = r->pid;
+            b->n = 0;
+        }
+        b->va[b->n++] = r->va;
+    }
+    if (b) atomic_store_explicit(&ring.tail, ++tail, memory_order_release);
+    atomic_store_explicit(&ring.done, TRUE, memory_order_release);
+    return NULL;
+}
+
+void replayPipelined(Replay_Stat* st) {
+    /*
+        reader thread 를 띄우고, ring 에서 batch 를 꺼내 순서대로 처리한다.
+    */
+    pthread_t tid;
+    unsigned long head = 0;
+    atomic_init(&ring.head, 0);
+    atomic_init(&ring.tail, 0);
+    atomic_init(&ring.done, FALSE);
+    if (pthread_create(&tid, NULL, reader, NULL)) {
+        printf("ku_replay: Cannot create reader thread\n");
+        exit(1);
+    }
+    while (1) {
+        if (head == atomic_load_explicit(&ring.tail, memory_order_acquire)) {
+            // done 을 본 뒤에 tail 을 다시 확인해야 마지막 batch 를 놓치지 않는다
+            if (atomic_load_explicit(&ring.done, memory_order_acquire)
+                && head == atomic_load_explicit(&ring.tail, memory_order_acquire)) break;
+            st->stalls++;
+            sched_yield();
+            continue;
+        }
+        Batch* b = ring.slot + (head & (RING_SIZE - 1));
+        replayBatch(st, b->pid, b->va, b->n);
+        atomic_store_explicit(&ring.head, ++head, memory_order_release);
+    }
+    pthread_join(tid, NULL);
+}
+
+void replayDirect(Replay_Stat* st) {
+    for (unsigned long long i = 0; i < trace.nrec; ++i)
+        replayBatch(st, trace.rec[i].pid, &trace.rec[i].va, 1);
+}
+
+void printPerf(const Replay_Stat* st, const long long* pc0, const long long* pc1) {
+    /*
+        replay 루프 전체의 접근 하나당 counter 값과, page fault 결과별 fault 하나당 평균을 출력한다. (없는 counter 는 -)
+    */
+    const char* kind_name[FAULT_NR + 1] = { "mapped", "first", "table", "swap-in", "fail", "all" };
+    printf("perf/access");
+    for (int c = 0; c < PERF_NR; ++c) {
+        if (pc0[c] < 0 || st->accesses == 0) printf("  %s -", perf_name[c]);
+        else printf("  %s %.1f", perf_name[c], (double)(pc1[c] - pc0[c]) / st->accesses);
+    }
+    printf("\n%-11s %10s", "perf/fault", "count");
+    for (int c = 0; c < PERF_NR; ++c) printf(" %14s", perf_name[c]);
+    printf("\n");
+    for (int k = 0; k <= FAULT_NR; ++k) {
+        if (ku_perf_fault_count(k) == 0) continue;
+        printf("  %-9s %10lu", kind_name[k], ku_perf_fault_count(k));
+        for (int c = 0; c < PERF_NR; ++c) {
+            double avg = ku_perf_fault_avg(k, c);
+            if (avg < 0) printf(" %14s", "-");
+            else printf(" %14.1f", avg);
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int pmem_size = 256, swap_size = 512;
+    int pipelined = TRUE, perf = FALSE;
+    long long pc0[PERF_NR], pc1[PERF_NR];
+    const char* json = NULL;
+    const char* timeline = NULL;
+    Replay_Stat st;
+    double start, elapsed;
+
+    while (argc > 1 && argv[1][0] == '-') {
+        if (strcmp(argv[1], "-s") == 0) pipelined = FALSE;
+        else if (strcmp(argv[1], "-p") == 0) perf = TRUE;
+        else if (strcmp(argv[1], "-H") == 0) ku_set_pt_mode(PT_HASHED);
+        else if (strcmp(argv[1], "-S") == 0) ku_set_superpage(TRUE);
+        else if (strcmp(argv[1], "-j") == 0 && argc > 2) {
+            json = argv[2];
+            argc--;
+            argv++;
+        }
+        else if (strcmp(argv[1], "-t") == 0 && argc > 2) {
+            timeline = argv[2];
+            argc--;
+            argv++;
+        }
+        else break;
+        argc--;
+        argv++;
+    }
+    if (argc < 2 || argc > 4) {
+        printf("ku_replay: Wrong number of arguments\n");
+        printf("usage: ku_replay [-s] [-p] [-H] [-S] [-j json] [-t timeline] <trace> [pmem_size] [swap_size]\n");
+        exit(1);
+    }
+    if (argc > 2) pmem_size = atoi(argv[2]);
+    if (argc > 3) swap_size = atoi(argv[3]);
+    if (ku_trace_open(&trace, argv[1])) {
+        printf("ku_replay: Cannot open trace %s\n", argv[1]);
+        exit(1);
+    }
+    if (ku_mmu_init(pmem_size, swap_size) == 0) {
+        printf("ku_replay: ku_mmu_init failed\n");
+        exit(1);
+    }
+
+    if (timeline && ku_mmu_timeline_start(timeline) < 0)
+        printf("ku_replay: Cannot write timeline %s (build with -DKU_MMU_TRACE)\n", timeline);
+
+    if (perf && ku_perf_start() < 0) {
+        printf("ku_replay: Cannot open hardware counters\n");
+        perf = FALSE;
+    }
+
+    memset(&st, 0, sizeof(st));
+    st.cur = -1;
+    if (perf) ku_perf_read(pc0);
+    start = getTime();
+    if (pipelined) replayPipelined(&st);
+    else replayDirect(&st);
+    elapsed = getTime() - start;
+    if (perf) {
+        ku_perf_read(pc1);
+        ku_perf_stop();
+    }
+    if (timeline) ku_mmu_timeline_stop();
+
+    printf("records     %llu\n", trace.nrec);
+    printf("accesses    %llu (blocked %llu)\n", st.accesses, st.blocked);
+    printf("switches    %llu\n", st.switches);
+    printf("faults      %lu (failed %lu)\n", ku_fault_count(FAULT_NR), ku_fault_count(FAULT_FAIL));
+    printf("swap-ins    %lu\n", nr_swapin);
+    printf("swap-outs   %lu\n", nr_swapout);
+    printf("fault kinds mapped %lu, first %lu, table %lu, swap-in %lu\n", ku_fault_count(FAULT_MAPPED),
+        ku_fault_count(FAULT_FIRST), ku_fault_count(FAULT_TABLE), ku_fault_count(FAULT_SWAPIN));
+    printf("page table  %s, %ld bytes\n", pt_mode == PT_HASHED ? "hashed" : "radix", ku_pt_bytes());
+    if (superpage) printf("superpages  promoted %lu, demoted %lu\n", nr_promote, nr_demote);
+    printf("walk refs   avg %.3f (1: %lu, 2: %lu, 3: %lu)", ku_walk_avg_refs(), ku_walk_count(1), ku_walk_count(2), ku_walk_count(3));
+    if (ku_pwc_hit_rate(PWC_PMD) >= 0)
+        printf(", pwc hit pmd %.1f%%, pd %.1f%%", 100 * ku_pwc_hit_rate(PWC_PMD), 100 * ku_pwc_hit_rate(PWC_PD));
+    printf("\n");
+    printf("fault ns    p50 %lld, p99 %lld, max %lld\n", ku_fault_latency(FAULT_NR, 0.5),
+        ku_fault_latency(FAULT_NR, 0.99), ku_fault_latency(FAULT_NR, 1));
+    if (pipelined) printf("stalls      %llu\n", st.stalls);
+    printf("elapsed     %.6f s\n", elapsed);
+    printf("accesses/s  %.0f\n", elapsed > 0 ? st.accesses / elapsed : 0);
+    if (perf) printPerf(&st, pc0, pc1);
+
+    if (json) {
+        FILE* fp = fopen(json, "w");
+        if (fp == NULL) printf("ku_replay: Cannot write %s\n", json);
+        else {
+            ku_fault_stats_json(fp);
+            fclose(fp);
+        }
+    }
+
+    ku_mmu_destroy();
+    ku_trace_close(&trace);
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/*
+    메모리 접근 trace 파일 형식
+    : Trace_Header 뒤에 Trace_Rec 이 nrec 개 이어진다. (리틀 엔디언, 레코드 하나에 4 바이트)
+*/
+#define TRACE_MAGIC "KUTRACE1"
+#define TRACE_VERSION 1
+
+/* trace op */
+#define TRACE_OP_READ 0
+#define TRACE_OP_WRITE 1
+
+/*
+    trace 파일 헤더
+        - magic: TRACE_MAGIC
+        - rec_size: 레코드 하나의 크기 (sizeof(Trace_Rec))
+        - nrec: 레코드 수
+*/
+typedef struct trace_header_ {
+    char magic[8];
+    unsigned int version;
+    unsigned int rec_size;
+    unsigned long long nrec;
+} Trace_Header;
+
+/*
+    trace 레코드
+        - pid: 접근한 process 의 id
+        - op: TRACE_OP_READ/TRACE_OP_WRITE
+        - va: 접근한 Virtual Address
+*/
+typedef struct trace_rec_ {
+    unsigned char pid;
+    unsigned char op;
+    unsigned char va;
+    unsigned char pad;
+} Trace_Rec;
+
+/*
+    mmap 으로 연 trace 파일
+*/
+typedef struct trace_ {
+    void* map;
+    size_t map_len;
+    const Trace_Rec* rec;
+    unsigned long long nrec;
+} Trace;
+
+
+
+
+int ku_trace_open(Trace* t, const char* path) {
+    /*
+        path 의 trace 파일을 읽기 전용으로 mmap 한다. 앞에서부터 순서대로 읽는다고 커널에 알려서 미리 읽어오게 한다.
+        성공하면 0, 파일이 없거나 형식이 맞지 않으면 -1 반환.
+    */
+    struct stat st;
+    const Trace_Header* h;
+    int fd = open(path, O_RDONLY);
+    memset(t, 0, sizeof(Trace));
+    if (fd < 0) return -1;
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(Trace_Header)) {
+        close(fd);
+        return -1;
+    }
+    t->map_len = st.st_size;
+    t->map = mmap(NULL, t->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (t->map == MAP_FAILED) {
+        t->map = NULL;
+        return -1;
+    }
+    h = (const Trace_Header*)t->map;
+    if (memcmp(h->magic, TRACE_MAGIC, 8) || h->version != TRACE_VERSION || h->rec_size != sizeof(Trace_Rec)
+        || h->nrec > (t->map_len - sizeof(Trace_Header)) / sizeof(Trace_Rec)) {
+        munmap(t->map, t->map_len);
+        t->map = NULL;
+        return -1;
+    }
+    madvise(t->map, t->map_len, MADV_SEQUENTIAL);
+    t->rec = (const Trace_Rec*)((const char*)t->map + sizeof(Trace_Header));
+    t->nrec = h->nrec;
+    return 0;
+}
+
+void ku_trace_close(Trace* t) {
+    if (t->map) munmap(t->map, t->map_len);
+    memset(t, 0, sizeof(Trace));
+}
+
+int ku_trace_write(const char* path, const Trace_Rec* rec, unsigned long long nrec) {
+    /*
+        nrec 개의 레코드를 trace 파일로 저장한다. 성공하면 0, 실패하면 -1 반환.
+    */
+    Trace_Header h;
+    FILE* fp = fopen(path, "wb");
+    if (fp == NULL) return -1;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, TRACE_MAGIC, 8);
+    h.version = TRACE_VERSION;
+    h.rec_size = sizeof(Trace_Rec);
+    h.nrec = nrec;
+    if (fwrite(&h, sizeof(h), 1, fp) != 1 || fwrite(rec, sizeof(Trace_Rec), nrec, fp) != nrec) {
+        fclose(fp);
+        return -1;
+    }
+    return fclose(fp) ? -1 : 0;
+}
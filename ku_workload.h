@@ -0,0 +1,166 @@
+#include <math.h>
+#include <string.h>
+#include "ku_trace.h"
+
+/*
+    seed 로 재현 가능한 메모리 접근 패턴 생성기
+    : phase 들을 차례로 돌면서 Trace_Rec 을 만든다. 같은 Workload 와 seed 면 항상 같은 레코드가 나온다.
+      가상 주소 공간이 8 bit 라서 process 하나가 쓸 수 있는 페이지는 최대 WL_MAX_PAGES 개이다.
+      zipf 분포를 만들 때 pow 를 쓰므로, 이 헤더를 쓰는 프로그램은 -lm 으로 링크해야 한다.
+*/
+#define WL_MAX_PAGES 64  // 가상 페이지 수 (va >> PT_SHIFT)
+#define WL_MAX_PHASE 16
+#define WL_MAX_PROC 255
+
+/* workload pattern */
+#define WL_SEQ 0  // base 부터 npages 개 페이지를 순서대로 반복
+#define WL_STRIDE 1  // stride 페이지씩 건너뛰며 반복
+#define WL_ZIPF 2  // zipf_s 지수의 Zipf 분포 (base 쪽 페이지가 hot)
+#define WL_UNIFORM 3  // 균등 분포
+
+/*
+    workload phase
+        - pattern: WL_SEQ/WL_STRIDE/WL_ZIPF/WL_UNIFORM
+        - length: 이 phase 에서 만들 접근 수 (모든 process 합)
+        - base: 접근 영역의 첫 가상 페이지 번호
+        - npages: 접근 영역의 페이지 수
+        - stride: WL_STRIDE 의 보폭 (페이지 단위)
+        - zipf_s: WL_ZIPF 의 지수
+        - write_ratio: TRACE_OP_WRITE 로 만들 접근의 비율
+*/
+typedef struct wl_phase_ {
+    int pattern;
+    unsigned long long length;
+    int base;
+    int npages;
+    int stride;
+    double zipf_s;
+    double write_ratio;
+} WL_Phase;
+
+/*
+    workload
+        - seed: 난수 seed
+        - nproc: process 수 (pid 1 ~ nproc)
+        - switch_every: 평균 몇 번 접근마다 다른 process 로 context switch 할지 (0 이면 switch 하지 않음)
+*/
+typedef struct workload_ {
+    unsigned long long seed;
+    int nproc;
+    int switch_every;
+    int nphase;
+    WL_Phase phase[WL_MAX_PHASE];
+} Workload;
+
+
+
+
+unsigned long long wlRand(unsigned long long* state) {
+    /*
+        splitmix64 (seed 하나로 재현 가능한 64 bit 난수)
+    */
+    unsigned long long z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+double wlRandUnit(unsigned long long* state) {
+    /*
+        [0, 1) 범위의 난수
+    */
+    return (wlRand(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void ku_workload_init(Workload* wl, unsigned long long seed, int nproc, int switch_every) {
+    memset(wl, 0, sizeof(Workload));
+    wl->seed = seed;
+    wl->nproc = nproc < 1 ? 1 : nproc > WL_MAX_PROC ? WL_MAX_PROC : nproc;
+    wl->switch_every = switch_every;
+}
+
+int ku_workload_add_phase(Workload* wl, int pattern, unsigned long long length, int base, int npages, double param, double write_ratio) {
+    /*
+        phase 를 하나 추가한다. param 은 WL_STRIDE 면 보폭, WL_ZIPF 면 지수로 쓰인다.
+        영역이 가상 주소 공간을 벗어나면 잘라내고, phase 가 가득 찼거나 인자가 잘못되었으면 -1 반환.
+    */
+    WL_Phase* ph;
+    if (wl->nphase == WL_MAX_PHASE || pattern < WL_SEQ || pattern > WL_UNIFORM || base < 0 || base >= WL_MAX_PAGES || npages < 1) return -1;
+    ph = wl->phase + wl->nphase++;
+    ph->pattern = pattern;
+    ph->length = length;
+    ph->base = base;
+    ph->npages = base + npages > WL_MAX_PAGES ? WL_MAX_PAGES - base : npages;
+    ph->stride = pattern == WL_STRIDE && param >= 1 ? (int)param : 1;
+    ph->zipf_s = pattern == WL_ZIPF ? param : 0;
+    ph->write_ratio = write_ratio;
+    return 0;
+}
+
+unsigned long long ku_workload_length(const Workload* wl) {
+    unsigned long long n = 0;
+    for (int i = 0; i < wl->nphase; ++i) n += wl->phase[i].length;
+    return n;
+}
+
+unsigned long long ku_workload_generate(const Workload* wl, Trace_Rec* out, unsigned long long max) {
+    /*
+        wl 의 phase 들을 차례로 돌면서 최대 max 개의 레코드를 out 에 만들고, 만든 레코드 수를 반환한다.
+        순차/stride 패턴의 위치는 process 마다 따로 기억하고, phase 가 바뀌면 처음부터 다시 시작한다.
+    */
+    unsigned long long st = wl->seed, n = 0;
+    int cursor[WL_MAX_PROC + 1];
+    double cdf[WL_MAX_PAGES];
+    int pid = 1 + (int)(wlRand(&st) % wl->nproc);
+
+    for (int p = 0; p < wl->nphase && n < max; ++p) {
+        const WL_Phase* ph = wl->phase + p;
+        memset(cursor, 0, sizeof(cursor));
+        if (ph->pattern == WL_ZIPF) {
+            // rank k (0 부터) 의 가중치는 1 / (k + 1)^s
+            double sum = 0, acc = 0;
+            for (int k = 0; k < ph->npages; ++k) sum += 1.0 / pow(k + 1, ph->zipf_s);
+            for (int k = 0; k < ph->npages; ++k) {
+                acc += 1.0 / pow(k + 1, ph->zipf_s) / sum;
+                cdf[k] = acc;
+            }
+            cdf[ph->npages - 1] = 1.0;
+        }
+        for (unsigned long long i = 0; i < ph->length && n < max; ++i) {
+            int page;
+            // context switch
+            if (wl->nproc > 1 && wl->switch_every > 0 && wlRand(&st) % wl->switch_every == 0) {
+                int next = 1 + (int)(wlRand(&st) % (wl->nproc - 1));
+                pid = next >= pid ? next + 1 : next;
+            }
+            switch (ph->pattern) {
+            case WL_SEQ:
+                page = cursor[pid]++ % ph->npages;
+                break;
+            case WL_STRIDE:
+                page = (int)((long long)cursor[pid]++ * ph->stride % ph->npages);
+                break;
+            case WL_ZIPF: {
+                double u = wlRandUnit(&st);
+                int lo = 0, hi = ph->npages - 1;
+                while (lo < hi) {
+                    int mid = (lo + hi) / 2;
+                    if (cdf[mid] < u) lo = mid + 1;
+                    else hi = mid;
+                }
+                page = lo;
+                break;
+            }
+            default:
+                page = (int)(wlRand(&st) % ph->npages);
+                break;
+            }
+            out[n].pid = (unsigned char)pid;
+            out[n].op = wlRandUnit(&st) < ph->write_ratio ? TRACE_OP_WRITE : TRACE_OP_READ;
+            out[n].va = (unsigned char)(((ph->base + page) << 2) | (wlRand(&st) & 3));
+            out[n].pad = 0;
+            n++;
+        }
+    }
+    return n;
+}